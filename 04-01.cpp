@@ -1,122 +1,3428 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <compare>
+#include <cmath>
+#include <condition_variable>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <functional>
+#include <fstream>
+#include <future>
+#include <iterator>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <numeric>
+#include <random>
 #include <ranges>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 const std::size_t SORT_THRESHOLD = 16;
+const std::size_t NINTHER_THRESHOLD = 128;
+const std::size_t PARTIAL_ORDER_LIMIT = 8;
+const std::size_t OFFSET_BLOCK_SIZE = 64;
+const std::size_t RADIX_THRESHOLD = 1024;
+const std::size_t RADIX_BUCKETS = 256;
+const std::size_t MULTIKEY_THRESHOLD = 64;
+const std::size_t STRING_WORD_BYTES = 7;
+const std::size_t NETWORK_SIZE = 16;
+const std::size_t MIN_RUN = 64;
+const std::size_t MIN_GALLOP = 7;
+const std::size_t PARALLEL_THRESHOLD = 1 << 14;
+const std::size_t PARALLEL_PARTITION_THRESHOLD = 1 << 20;
+const std::size_t PARTITION_BLOCK_SIZE = 1 << 16;
+const std::size_t EXTERNAL_BLOCK_SIZE = 1 << 20;
+const std::size_t LSM_BATCH_SIZE = 1 << 12;
+const std::size_t LEVEL_GROWTH = 8;
+const std::size_t BENCHMARK_ELEMENTS = 1 << 16;
+const std::size_t BENCHMARK_ROUNDS = 5;
+const double BENCHMARK_TOLERANCE = 0.1;
 
-template <typename T>
-void Order(std::vector<T> &vector, std::size_t left, std::size_t right) {
+// Insertion sort that lifts each out-of-place element into a hole and
+// shifts the larger ones right, so every element moves instead of swapping.
+template <std::random_access_iterator It, typename Less>
+void Order(It data, std::size_t left, std::size_t right, Less &less) {
   for (auto i = left + 1; i < right; ++i) {
-    for (auto j = i; j > left; --j) {
-      if (vector[j] < vector[j - 1]) {
-        std::swap(vector[j], vector[j - 1]);
-      } else {
-        break;
-      }
+    if (!less(data[i], data[i - 1])) {
+      continue;
     }
+    std::iter_value_t<It> hole = std::ranges::iter_move(data + i);
+    auto j = i;
+    do {
+      data[j] = std::ranges::iter_move(data + (j - 1));
+      --j;
+    } while (j > left && less(hole, data[j - 1]));
+    data[j] = std::move(hole);
   }
 }
 
+// True when Less orders values of T exactly like operator<, which lets Sort
+// pick the radix and network engines that only know the natural order.
+template <typename Less, typename T>
+concept NaturalOrder = std::same_as<Less, std::ranges::less> ||
+                       std::same_as<Less, std::less<>> || std::same_as<Less, std::less<T>>;
+
+template <typename T>
+concept NetworkKey = (std::signed_integral<T> && (sizeof(T) == 4 || sizeof(T) == 8)) ||
+                     std::same_as<T, float> || std::same_as<T, double>;
+
+// Largest range that is finished as a leaf instead of being partitioned.
+// Specialize it to tune a single element type; network types cannot go above
+// NETWORK_SIZE.
 template <typename T>
-std::size_t Partition(std::vector<T> &vector, std::size_t left,
-                      std::size_t right) {
+inline constexpr std::size_t LEAF_THRESHOLD = NetworkKey<T> ? NETWORK_SIZE : SORT_THRESHOLD;
+
+template <typename T, std::size_t LANES> struct NetworkRegister {
+  typedef T Type __attribute__((vector_size(sizeof(T) * LANES)));
+  typedef T Memory __attribute__((vector_size(sizeof(T) * LANES), aligned(alignof(T)), may_alias));
+};
+
+template <typename T> struct NetworkRegister<T, 1> {
+  using Type = T;
+  using Memory = T;
+};
+
+// Bitonic sorting network over SIZE keys kept in registers of LANES keys
+// each. Exchanges between registers are plain lane-wise compare-and-select,
+// exchanges inside a register shuffle it against itself and blend the
+// minima and maxima back with a constant mask. The code is written once with
+// vector extensions; the entry points below compile it for each ISA.
+template <typename T, std::size_t LANES, std::size_t SIZE> class BitonicNetwork {
+public:
+  [[gnu::always_inline]] static inline void Sort(T *data) {
+    auto *memory = reinterpret_cast<Memory *>(data);
+    Register registers[REGISTERS];
+    for (std::size_t r = 0; r < REGISTERS; ++r) {
+      registers[r] = memory[r];
+    }
+    Stages<2>(registers);
+    for (std::size_t r = 0; r < REGISTERS; ++r) {
+      memory[r] = registers[r];
+    }
+  }
+
+private:
+  using Register = typename NetworkRegister<T, LANES>::Type;
+  using Memory = typename NetworkRegister<T, LANES>::Memory;
+  static constexpr std::size_t REGISTERS = SIZE / LANES;
+
+  // Lane i is the lower end of its pair in step (K, J) when its J bit is
+  // clear, and the block of size K it belongs to is sorted ascending when its
+  // K bit is clear.
+  static constexpr bool TakesMinimum(std::size_t lane, std::size_t k,
+                                     std::size_t j) {
+    return ((lane & j) == 0) == ((lane & k) == 0);
+  }
+
+  [[gnu::always_inline]] static inline void CompareExchange(Register &lower,
+                                                            Register &upper) {
+    auto swap = upper < lower;
+    Register minimum = swap ? upper : lower;
+    Register maximum = swap ? lower : upper;
+    lower = minimum;
+    upper = maximum;
+  }
+
+  template <std::size_t K, std::size_t J, std::size_t R>
+  [[gnu::always_inline]] static inline void Step(Register (&registers)[REGISTERS]) {
+    constexpr auto FIRST = R * LANES;
+    if constexpr (J >= LANES) {
+      if constexpr ((FIRST & J) == 0) {
+        constexpr auto PARTNER = R + J / LANES;
+        if constexpr ((FIRST & K) == 0) {
+          CompareExchange(registers[R], registers[PARTNER]);
+        } else {
+          CompareExchange(registers[PARTNER], registers[R]);
+        }
+      }
+    } else {
+      // Each lane keeps its own key on a tie, so keys that compare equal but
+      // differ in bits (like -0.0 and +0.0) are never duplicated.
+      [&]<std::size_t... LANE>(std::index_sequence<LANE...>) {
+        Register self = registers[R];
+        Register partner = __builtin_shufflevector(self, self, (LANE ^ J)...);
+        Register minimum = partner < self ? partner : self;
+        Register maximum = self < partner ? partner : self;
+        registers[R] = __builtin_shufflevector(
+            minimum, maximum, (TakesMinimum(FIRST + LANE, K, J) ? LANE : LANES + LANE)...);
+      }(std::make_index_sequence<LANES>{});
+    }
+  }
+
+  template <std::size_t K, std::size_t J>
+  [[gnu::always_inline]] static inline void Merge(Register (&registers)[REGISTERS]) {
+    [&]<std::size_t... R>(std::index_sequence<R...>) {
+      (Step<K, J, R>(registers), ...);
+    }(std::make_index_sequence<REGISTERS>{});
+    if constexpr (J > 1) {
+      Merge<K, J / 2>(registers);
+    }
+  }
+
+  template <std::size_t K>
+  [[gnu::always_inline]] static inline void Stages(Register (&registers)[REGISTERS]) {
+    Merge<K, K / 2>(registers);
+    if constexpr (K < SIZE) {
+      Stages<K * 2>(registers);
+    }
+  }
+};
+
+template <NetworkKey T> using NetworkKernel = void (*)(T *);
+
+template <NetworkKey T> void SortNetworkScalar(T *data) {
+  BitonicNetwork<T, 1, NETWORK_SIZE>::Sort(data);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template <NetworkKey T> __attribute__((target("sse4.2"))) void SortNetworkSse4(T *data) {
+  BitonicNetwork<T, 16 / sizeof(T), NETWORK_SIZE>::Sort(data);
+}
+
+template <NetworkKey T> __attribute__((target("avx2"))) void SortNetworkAvx2(T *data) {
+  BitonicNetwork<T, 32 / sizeof(T), NETWORK_SIZE>::Sort(data);
+}
+#endif
+
+template <NetworkKey T> NetworkKernel<T> SelectNetworkKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SortNetworkAvx2<T>;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return SortNetworkSse4<T>;
+  }
+#endif
+  return SortNetworkScalar<T>;
+}
+
+// Finishes a range of at most LEAF_THRESHOLD elements. Network keys are
+// padded up to NETWORK_SIZE with the largest value of the type and sorted by
+// the widest kernel the CPU supports.
+template <std::random_access_iterator It, typename Less>
+void SortLeaf(It data, std::size_t left, std::size_t right, Less &less) {
+  using T = std::iter_value_t<It>;
+  if constexpr (NetworkKey<T> && NaturalOrder<Less, T>) {
+    static_assert(LEAF_THRESHOLD<T> <= NETWORK_SIZE);
+    static const auto kernel = SelectNetworkKernel<T>();
+    if (right - left < 2) {
+      return;
+    }
+    alignas(32) std::array<T, NETWORK_SIZE> keys;
+    keys.fill(std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                   : std::numeric_limits<T>::max());
+    std::copy(data + left, data + right, keys.begin());
+    kernel(keys.data());
+    std::copy(keys.begin(), keys.begin() + (right - left), data + left);
+  } else {
+    Order(data, left, right, less);
+  }
+}
+
+// Inserts like Order, but gives up once more than PARTIAL_ORDER_LIMIT
+// elements had to be moved. Returns whether the range ended up sorted.
+template <std::random_access_iterator It, typename Less>
+bool PartialOrder(It data, std::size_t left, std::size_t right, Less &less) {
+  std::size_t moves = 0;
+  for (auto i = left + 1; i < right; ++i) {
+    if (!less(data[i], data[i - 1])) {
+      continue;
+    }
+    std::iter_value_t<It> hole = std::ranges::iter_move(data + i);
+    auto j = i;
+    do {
+      data[j] = std::ranges::iter_move(data + (j - 1));
+      --j;
+    } while (j > left && less(hole, data[j - 1]));
+    data[j] = std::move(hole);
+
+    moves += i - j;
+    if (moves > PARTIAL_ORDER_LIMIT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <std::random_access_iterator It, typename Less>
+void SiftDown(It data, std::size_t left, std::size_t size, std::size_t root,
+              Less &less) {
+  while (2 * root + 1 < size) {
+    auto child = 2 * root + 1;
+    if (child + 1 < size && less(data[left + child], data[left + child + 1])) {
+      ++child;
+    }
+    if (!less(data[left + root], data[left + child])) {
+      return;
+    }
+    std::ranges::iter_swap(data + (left + root), data + (left + child));
+    root = child;
+  }
+}
+
+template <std::random_access_iterator It, typename Less>
+void HeapSort(It data, std::size_t left, std::size_t right, Less &less) {
+  auto size = right - left;
+  for (auto root = size / 2; root-- > 0;) {
+    SiftDown(data, left, size, root, less);
+  }
+  for (auto end = size; end > 1; --end) {
+    std::ranges::iter_swap(data + left, data + (left + end - 1));
+    SiftDown(data, left, end - 1, 0, less);
+  }
+}
+
+template <std::random_access_iterator It, typename Less>
+void Sort3(It data, std::size_t a, std::size_t b, std::size_t c, Less &less) {
+  if (less(data[b], data[a])) {
+    std::ranges::iter_swap(data + a, data + b);
+  }
+  if (less(data[c], data[b])) {
+    std::ranges::iter_swap(data + b, data + c);
+  }
+  if (less(data[b], data[a])) {
+    std::ranges::iter_swap(data + a, data + b);
+  }
+}
+
+// Moves the median of three, or Tukey's ninther for large ranges, to
+// data[left]. Either way some element after it is not smaller than the
+// pivot, which the partition scans rely on as a sentinel.
+template <std::random_access_iterator It, typename Less>
+void ChoosePivot(It data, std::size_t left, std::size_t right, Less &less) {
   auto mid = left + (right - left) / 2;
   auto last = right - 1;
 
-  if (vector[mid] < vector[left]) {
-    std::swap(vector[left], vector[mid]);
+  if (right - left > NINTHER_THRESHOLD) {
+    Sort3(data, left, mid, last, less);
+    Sort3(data, left + 1, mid - 1, last - 1, less);
+    Sort3(data, left + 2, mid + 1, last - 2, less);
+    Sort3(data, mid - 1, mid, mid + 1, less);
+    std::ranges::iter_swap(data + left, data + mid);
+  } else {
+    Sort3(data, mid, left, last, less);
   }
-  if (vector[last] < vector[left]) {
-    std::swap(vector[left], vector[last]);
+}
+
+// Partitions [left, right) around the pivot stored at data[left], which
+// stays in place until the end, and returns the pivot's final position.
+// The pivot is only ever compared by reference, never copied. Elements
+// equal to it end up on its right. The flag is set when no element had to
+// be swapped, i.e. the range was likely already sorted.
+template <std::random_access_iterator It, typename Less>
+std::pair<std::size_t, bool> PartitionHoare(It data, std::size_t left,
+                                            std::size_t right, Less &less) {
+  auto &&pivot = data[left];
+  auto i = left + 1;
+  auto j = right;
+
+  while (less(data[i], pivot)) {
+    ++i;
   }
-  if (vector[last] < vector[mid]) {
-    std::swap(vector[mid], vector[last]);
+
+  if (i == left + 1) {
+    while (i < j && !less(data[j - 1], pivot)) {
+      --j;
+    }
+  } else {
+    while (!less(data[j - 1], pivot)) {
+      --j;
+    }
   }
 
-  auto pivot = vector[mid];
-  auto i = left;
-  auto j = right;
+  bool alreadyPartitioned = i >= j;
 
-  while (true) {
-    while (vector[i] < pivot) {
+  while (i < j) {
+    std::ranges::iter_swap(data + i, data + (j - 1));
+    ++i;
+    --j;
+    while (less(data[i], pivot)) {
       ++i;
     }
-
-    while (vector[j - 1] > pivot) {
+    while (!less(data[j - 1], pivot)) {
       --j;
     }
+  }
+
+  std::ranges::iter_swap(data + left, data + (i - 1));
+  return {i - 1, alreadyPartitioned};
+}
 
-    if (i >= j - 1) {
-      return j - 1;
+// Exchanges count pairs data[leftBase + offsetsLeft[k]] and
+// data[rightBase - offsetsRight[k]]. Unless both blocks are exhausted
+// together, the pairs are rotated as one cycle through a single hole, which
+// costs one move per element instead of three.
+template <std::random_access_iterator It>
+void SwapOffsets(It data, std::size_t leftBase, std::size_t rightBase,
+                 const unsigned char *offsetsLeft,
+                 const unsigned char *offsetsRight, std::size_t count,
+                 bool useSwaps) {
+  if (useSwaps) {
+    for (std::size_t k = 0; k < count; ++k) {
+      std::ranges::iter_swap(data + (leftBase + offsetsLeft[k]),
+                             data + (rightBase - offsetsRight[k]));
+    }
+  } else if (count > 0) {
+    auto l = leftBase + offsetsLeft[0];
+    auto r = rightBase - offsetsRight[0];
+    std::iter_value_t<It> hole = std::ranges::iter_move(data + l);
+    data[l] = std::ranges::iter_move(data + r);
+    for (std::size_t k = 1; k < count; ++k) {
+      l = leftBase + offsetsLeft[k];
+      data[r] = std::ranges::iter_move(data + l);
+      r = rightBase - offsetsRight[k];
+      data[l] = std::ranges::iter_move(data + r);
     }
+    data[r] = std::move(hole);
+  }
+}
 
-    std::swap(vector[i], vector[j - 1]);
+// BlockQuicksort: same contract as PartitionHoare, but instead of branching
+// on every comparison the scans only record the offsets of misplaced
+// elements of a block, which compiles to a store and a conditional add. The
+// recorded elements are then exchanged in bulk.
+template <std::random_access_iterator It, typename Less>
+std::pair<std::size_t, bool> PartitionBlock(It data, std::size_t left,
+                                            std::size_t right, Less &less) {
+  auto &&pivot = data[left];
+  auto i = left + 1;
+  auto j = right;
+
+  while (less(data[i], pivot)) {
     ++i;
+  }
+
+  if (i == left + 1) {
+    while (i < j && !less(data[j - 1], pivot)) {
+      --j;
+    }
+  } else {
+    while (!less(data[j - 1], pivot)) {
+      --j;
+    }
+  }
+
+  bool alreadyPartitioned = i >= j;
+  if (!alreadyPartitioned) {
     --j;
+    std::ranges::iter_swap(data + i, data + j);
+    ++i;
+
+    alignas(64) std::array<unsigned char, OFFSET_BLOCK_SIZE> offsetsLeft;
+    alignas(64) std::array<unsigned char, OFFSET_BLOCK_SIZE> offsetsRight;
+    std::size_t leftBase = i;
+    std::size_t rightBase = j;
+    std::size_t countLeft = 0;
+    std::size_t countRight = 0;
+    std::size_t startLeft = 0;
+    std::size_t startRight = 0;
+
+    while (i < j) {
+      // Refill whichever offset block ran empty from the unknown middle.
+      auto unknown = j - i;
+      auto leftSplit = countLeft == 0 ? (countRight == 0 ? unknown / 2 : unknown) : 0;
+      auto rightSplit = countRight == 0 ? unknown - leftSplit : 0;
+      leftSplit = std::min(leftSplit, OFFSET_BLOCK_SIZE);
+      rightSplit = std::min(rightSplit, OFFSET_BLOCK_SIZE);
+
+      for (std::size_t k = 0; k < leftSplit; ++k) {
+        offsetsLeft[countLeft] = static_cast<unsigned char>(k);
+        countLeft += !less(data[i], pivot);
+        ++i;
+      }
+      for (std::size_t k = 0; k < rightSplit;) {
+        offsetsRight[countRight] = static_cast<unsigned char>(++k);
+        --j;
+        countRight += less(data[j], pivot);
+      }
+
+      auto count = std::min(countLeft, countRight);
+      SwapOffsets(data, leftBase, rightBase, offsetsLeft.data() + startLeft,
+                  offsetsRight.data() + startRight, count, countLeft == countRight);
+      countLeft -= count;
+      countRight -= count;
+      startLeft += count;
+      startRight += count;
+
+      if (countLeft == 0) {
+        startLeft = 0;
+        leftBase = i;
+      }
+      if (countRight == 0) {
+        startRight = 0;
+        rightBase = j;
+      }
+    }
+
+    // One block may still hold misplaced elements; move them to the border.
+    if (countLeft > 0) {
+      while (countLeft > 0) {
+        --countLeft;
+        --j;
+        std::ranges::iter_swap(data + (leftBase + offsetsLeft[startLeft + countLeft]), data + j);
+      }
+      i = j;
+    }
+    if (countRight > 0) {
+      while (countRight > 0) {
+        --countRight;
+        std::ranges::iter_swap(data + (rightBase - offsetsRight[startRight + countRight]),
+                               data + i);
+        ++i;
+      }
+      j = i;
+    }
   }
+
+  std::ranges::iter_swap(data + left, data + (i - 1));
+  return {i - 1, alreadyPartitioned};
 }
 
+// Whether Partition uses the branchless block scheme for a type. It wins when
+// comparisons are cheap and mispredicted about half the time, as for numbers
+// and pointers on random data. Specialize it to switch a type over either way;
+// types with expensive comparisons like std::string keep the Hoare loop.
 template <typename T>
-void Split(std::vector<T> &vector, std::size_t left, std::size_t right) {
-  if (right - left > SORT_THRESHOLD) {
-    auto pivotIndex = Partition(vector, left, right);
-    Split(vector, left, pivotIndex);
-    Split(vector, pivotIndex, right);
+inline constexpr bool BLOCK_PARTITION = std::is_arithmetic_v<T> || std::is_pointer_v<T>;
+
+template <std::random_access_iterator It, typename Less>
+std::pair<std::size_t, bool> Partition(It data, std::size_t left,
+                                       std::size_t right, Less &less) {
+  if constexpr (BLOCK_PARTITION<std::iter_value_t<It>>) {
+    return PartitionBlock(data, left, right, less);
+  } else {
+    return PartitionHoare(data, left, right, less);
+  }
+}
+
+// Used when the pivot at data[left] equals the element before the range,
+// so nothing in the range is smaller than it. Moves every copy of the pivot
+// to the front and returns the position of the last one.
+template <std::random_access_iterator It, typename Less>
+std::size_t PartitionEqual(It data, std::size_t left, std::size_t right,
+                           Less &less) {
+  auto &&pivot = data[left];
+  auto i = left;
+  auto j = right - 1;
+
+  while (less(pivot, data[j])) {
+    --j;
+  }
+
+  if (j + 1 == right) {
+    while (i < j && !less(pivot, data[i + 1])) {
+      ++i;
+    }
   } else {
-    Order(vector, left, right);
+    while (!less(pivot, data[i + 1])) {
+      ++i;
+    }
+  }
+  ++i;
+
+  while (i < j) {
+    std::ranges::iter_swap(data + i, data + j);
+    --j;
+    ++i;
+    while (less(pivot, data[j])) {
+      --j;
+    }
+    while (!less(pivot, data[i])) {
+      ++i;
+    }
   }
+
+  std::ranges::iter_swap(data + left, data + j);
+  return j;
+}
+
+std::size_t DepthLimit(std::size_t size) {
+  return 2 * static_cast<std::size_t>(std::bit_width(size));
 }
 
-template <typename T> void Sort(std::vector<T> &vector) {
-  if (!vector.empty()) {
-    Split(vector, 0, vector.size());
+// Introsort: once depth partitions have been spent on a range it is finished
+// with HeapSort, which bounds the total work by O(n log n).
+template <std::random_access_iterator It, typename Less>
+void Split(It data, std::size_t left, std::size_t right, std::size_t depth,
+           Less &less) {
+  while (right - left > LEAF_THRESHOLD<std::iter_value_t<It>>) {
+    if (depth == 0) {
+      HeapSort(data, left, right, less);
+      return;
+    }
+    --depth;
+
+    ChoosePivot(data, left, right, less);
+
+    // data[left - 1] is never greater than the elements of the range, so a
+    // pivot equal to it is the minimum and all its copies can be skipped.
+    if (left > 0 && !less(data[left - 1], data[left])) {
+      left = PartitionEqual(data, left, right, less) + 1;
+      continue;
+    }
+
+    auto [pivotIndex, alreadyPartitioned] = Partition(data, left, right, less);
+    if (alreadyPartitioned && PartialOrder(data, left, pivotIndex, less) &&
+        PartialOrder(data, pivotIndex + 1, right, less)) {
+      return;
+    }
+
+    Split(data, left, pivotIndex, depth, less);
+    left = pivotIndex + 1;
   }
+  SortLeaf(data, left, right, less);
 }
 
-void TestIntegers() {
-  std::size_t size = 1000;
-  std::vector<int> vector(size);
+// Finishes ascending input and reverses strictly descending input in one
+// pass. Returns false as soon as the input turns out to be neither.
+template <std::random_access_iterator It, typename Less>
+bool OrderRun(It data, std::size_t size, Less &less) {
+  if (size < 2) {
+    return true;
+  }
+
+  std::size_t i = 1;
+  if (less(data[1], data[0])) {
+    while (i < size && less(data[i], data[i - 1])) {
+      ++i;
+    }
+    if (i < size) {
+      return false;
+    }
+    std::reverse(data, data + size);
+    return true;
+  }
+
+  while (i < size && !less(data[i], data[i - 1])) {
+    ++i;
+  }
+  return i == size;
+}
+
+template <typename T>
+concept RadixKey =
+    (std::integral<T> && !std::same_as<T, bool>) ||
+    (std::floating_point<T> && std::numeric_limits<T>::is_iec559 &&
+     (sizeof(T) == 4 || sizeof(T) == 8));
+
+// Maps a key to an unsigned integer with the same order. Signed integers get
+// their sign bit flipped. Negative floating-point values have all bits
+// inverted and the others get the sign bit set, so -0.0 lands right before
+// +0.0 and NaNs end up at whichever end their sign bit points to.
+template <RadixKey T> auto RadixImage(T value) {
+  if constexpr (std::integral<T>) {
+    using Bits = std::make_unsigned_t<T>;
+    auto bits = static_cast<Bits>(value);
+    if constexpr (std::is_signed_v<T>) {
+      bits ^= static_cast<Bits>(Bits(1) << (8 * sizeof(T) - 1));
+    }
+    return bits;
+  } else {
+    using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+    auto bits = std::bit_cast<Bits>(value);
+    auto sign = Bits(1) << (8 * sizeof(T) - 1);
+    return (bits & sign) != 0 ? static_cast<Bits>(~bits) : (bits | sign);
+  }
+}
+
+// LSD radix sort by the unsigned image of each item, one byte per pass. All
+// histograms are collected in a single pass and a byte that is the same in
+// every image costs no scatter pass at all. Every pass is stable, so items
+// with equal images keep their order.
+template <std::random_access_iterator It, typename Image>
+void RadixSortBy(It data, std::size_t size, Image image) {
+  using Item = std::iter_value_t<It>;
+  constexpr std::size_t PASSES = sizeof(std::invoke_result_t<Image &, const Item &>);
+  if (size == 0) {
+    return;
+  }
+  std::array<std::array<std::size_t, RADIX_BUCKETS>, PASSES> counts{};
   for (std::size_t i = 0; i < size; ++i) {
-    vector[i] = static_cast<int>(size - i);
+    auto bits = image(std::as_const(data[i]));
+    for (std::size_t pass = 0; pass < PASSES; ++pass) {
+      ++counts[pass][(bits >> (8 * pass)) & 0xFF];
+    }
+  }
+
+  std::vector<Item> buffer(size);
+  bool inBuffer = false;
+  for (std::size_t pass = 0; pass < PASSES; ++pass) {
+    auto &count = counts[pass];
+    auto shift = 8 * pass;
+    if (count[(image(std::as_const(data[0])) >> shift) & 0xFF] == size) {
+      continue;
+    }
+
+    std::array<std::size_t, RADIX_BUCKETS> offsets;
+    std::size_t offset = 0;
+    for (std::size_t digit = 0; digit < RADIX_BUCKETS; ++digit) {
+      offsets[digit] = offset;
+      offset += count[digit];
+    }
+    auto scatter = [&](auto source, auto target) {
+      for (std::size_t i = 0; i < size; ++i) {
+        Item item = source[i];
+        target[offsets[(image(std::as_const(item)) >> shift) & 0xFF]++] = item;
+      }
+    };
+    if (inBuffer) {
+      scatter(buffer.begin(), data);
+    } else {
+      scatter(data, buffer.begin());
+    }
+    inBuffer = !inBuffer;
+  }
+
+  if (inBuffer) {
+    std::copy(buffer.begin(), buffer.end(), data);
   }
-  Sort(vector);
-  assert(std::ranges::is_sorted(vector));
 }
 
-void TestDoubles() {
-  std::vector<double> vector = {0.5, 0.1, 0.9, 0.3, 0.2};
-  Sort(vector);
-  assert(std::ranges::is_sorted(vector));
+template <std::random_access_iterator It>
+  requires RadixKey<std::iter_value_t<It>>
+void RadixSort(It data, std::size_t size) {
+  using T = std::iter_value_t<It>;
+  RadixSortBy(data, size, [](T value) { return RadixImage(value); });
 }
 
-void TestStrings() {
-  std::vector<std::string> vector = {"banana", "apple", "cherry", "date"};
-  Sort(vector);
-  assert(std::ranges::is_sorted(vector));
+// Rearranges every column so that column[i] becomes the old
+// column[order[i]]. Each cycle of the permutation is rotated once through a
+// single hole per column, so every element is moved exactly once; order is
+// left as the identity.
+template <std::random_access_iterator... Columns>
+void ApplyPermutation(std::vector<std::size_t> &order, Columns... columns) {
+  for (std::size_t start = 0; start < order.size(); ++start) {
+    if (order[start] == start) {
+      continue;
+    }
+    std::tuple<std::iter_value_t<Columns>...> holes(std::ranges::iter_move(columns + start)...);
+    auto current = start;
+    while (order[current] != start) {
+      auto next = order[current];
+      ((columns[current] = std::ranges::iter_move(columns + next)), ...);
+      order[current] = current;
+      current = next;
+    }
+    std::apply([&](auto &...hole) { ((columns[current] = std::move(hole)), ...); }, holes);
+    order[current] = current;
+  }
 }
 
-void TestDuplicates() {
-  std::vector<int> vector = {5, 1, 5, 2, 5, 3, 5};
-  Sort(vector);
-  assert(std::ranges::is_sorted(vector));
+// Up to STRING_WORD_BYTES characters of value from depth on, packed big-endian
+// above a byte holding how many of them exist. Words compare like the strings
+// do over that window: bytes are unsigned as in std::char_traits<char>, and a
+// string that ends inside the window sorts before a longer one even when the
+// longer one continues with zeros.
+inline std::uint64_t StringWord(std::string_view value, std::size_t depth) {
+  if (depth + sizeof(std::uint64_t) <= value.size()) {
+    std::uint64_t bytes;
+    std::memcpy(&bytes, value.data() + depth, sizeof(bytes));
+    if constexpr (std::endian::native == std::endian::little) {
+      bytes = __builtin_bswap64(bytes);
+    }
+    return (bytes & ~std::uint64_t(0xFF)) | STRING_WORD_BYTES;
+  }
+  auto count = depth < value.size() ? std::min(value.size() - depth, STRING_WORD_BYTES) : 0;
+  std::uint64_t word = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto byte = static_cast<unsigned char>(value[depth + i]);
+    word |= std::uint64_t(byte) << (8 * (STRING_WORD_BYTES - i));
+  }
+  return word | count;
 }
 
-void TestSorted() {
-  std::vector<int> vector = {1, 2, 3, 4, 5};
-  Sort(vector);
-  assert(std::ranges::is_sorted(vector));
+// Multikey quicksort (three-way radix quicksort) over slots that hold a view
+// of each string, its original index and its next STRING_WORD_BYTES
+// characters packed into one word. Partitions compare the cached words and
+// swap slots, so they neither touch the string objects nor rescan the shared
+// prefix; the cache is refilled only when the equal part descends to the next
+// window. Buckets of at most SORT_THRESHOLD strings are finished by insertion,
+// comparing from depth on. The strings themselves move once, when the final
+// order is applied.
+template <std::random_access_iterator It>
+  requires std::same_as<std::iter_value_t<It>, std::string>
+void MultikeySort(It data, std::size_t size) {
+  struct Slot {
+    std::string_view view;
+    std::size_t index;
+    std::uint64_t word;
+  };
+  struct Bucket {
+    std::size_t left;
+    std::size_t right;
+    std::size_t depth;
+    bool cached;
+  };
+
+  std::vector<Slot> slots(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    slots[i] = {data[i], i, 0};
+  }
+
+  std::vector<Bucket> stack = {{0, size, 0, false}};
+  while (!stack.empty()) {
+    auto [left, right, depth, cached] = stack.back();
+    stack.pop_back();
+
+    if (right - left <= SORT_THRESHOLD) {
+      auto suffix = [depth](std::string_view view) {
+        return view.substr(std::min(depth, view.size()));
+      };
+      for (auto i = left + 1; i < right; ++i) {
+        auto slot = slots[i];
+        auto key = suffix(slot.view);
+        auto j = i;
+        for (; j > left && key < suffix(slots[j - 1].view); --j) {
+          slots[j] = slots[j - 1];
+        }
+        slots[j] = slot;
+      }
+      continue;
+    }
+
+    if (!cached) {
+      for (auto i = left; i < right; ++i) {
+        slots[i].word = StringWord(slots[i].view, depth);
+      }
+    }
+
+    auto a = slots[left].word;
+    auto b = slots[left + (right - left) / 2].word;
+    auto c = slots[right - 1].word;
+    auto pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+    auto lt = left;
+    auto gt = right;
+    for (auto i = left; i < gt;) {
+      if (slots[i].word < pivot) {
+        std::swap(slots[i++], slots[lt++]);
+      } else if (slots[i].word > pivot) {
+        std::swap(slots[i], slots[--gt]);
+      } else {
+        ++i;
+      }
+    }
+
+    if (lt > left) {
+      stack.push_back({left, lt, depth, true});
+    }
+    if (gt < right) {
+      stack.push_back({gt, right, depth, true});
+    }
+    // Strings that ended inside the window are equal; nothing left to do.
+    if ((pivot & 0xFF) == STRING_WORD_BYTES && gt - lt > 1) {
+      stack.push_back({lt, gt, depth + STRING_WORD_BYTES, false});
+    }
+  }
+
+  std::vector<std::size_t> order(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    order[i] = slots[i].index;
+  }
+  slots = {};
+  ApplyPermutation(order, data);
+}
+
+// Folds the projection into the comparator. Without a projection the
+// comparator is passed on unchanged, so the natural order stays recognizable.
+template <typename Compare, typename Projection>
+auto MakeLess(Compare &compare, Projection &projection) {
+  if constexpr (std::same_as<Projection, std::identity>) {
+    return compare;
+  } else {
+    return [&compare, &projection](auto &&lhs, auto &&rhs) -> bool {
+      return std::invoke(compare, std::invoke(projection, lhs),
+                         std::invoke(projection, rhs));
+    };
+  }
+}
+
+template <typename Range, typename Compare, typename Projection>
+concept SortableRange = std::ranges::random_access_range<Range> &&
+                        std::ranges::sized_range<Range> &&
+                        std::sortable<std::ranges::iterator_t<Range>, Compare, Projection>;
+
+// Sorts any sized random-access range (vectors, deques, spans, arrays and
+// views over them) by compare applied to the projected elements. Arithmetic
+// keys in their natural order with at least RADIX_THRESHOLD elements are
+// radix sorted, strings in their natural order with at least
+// MULTIKEY_THRESHOLD elements go through the multikey quicksort, and
+// everything else goes through the comparison-based Split.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+void Sort(Range &&range, Compare compare = {}, Projection projection = {}) {
+  auto data = std::ranges::begin(range);
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  auto less = MakeLess(compare, projection);
+  using T = std::ranges::range_value_t<Range>;
+
+  if (OrderRun(data, size, less)) {
+    return;
+  }
+  if constexpr (RadixKey<T> && NaturalOrder<decltype(less), T>) {
+    if (size >= RADIX_THRESHOLD) {
+      RadixSort(data, size);
+      return;
+    }
+  }
+  if constexpr (std::same_as<T, std::string> && NaturalOrder<decltype(less), T>) {
+    if (size >= MULTIKEY_THRESHOLD) {
+      MultikeySort(data, size);
+      return;
+    }
+  }
+  Split(data, 0, size, DepthLimit(size), less);
 }
 
-int main() {
+// Smallest index in [lo, hi) where holds(index) turns false, given that it
+// holds on a prefix of the range. Probes 1, 2, 4, ... elements in from the
+// chosen end before the binary search, so positions near that end are found
+// in O(log distance) comparisons.
+template <typename Predicate>
+std::size_t GallopPartitionPoint(std::size_t lo, std::size_t hi, bool fromEnd,
+                                 Predicate holds) {
+  std::size_t step = 1;
+  if (fromEnd) {
+    while (hi > lo) {
+      auto probe = hi - lo > step ? hi - step : lo;
+      if (holds(probe)) {
+        lo = probe + 1;
+        break;
+      }
+      hi = probe;
+      step *= 2;
+    }
+  } else {
+    while (lo < hi) {
+      auto probe = hi - lo > step ? lo + step - 1 : hi - 1;
+      if (!holds(probe)) {
+        hi = probe;
+        break;
+      }
+      lo = probe + 1;
+      step *= 2;
+    }
+  }
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    if (holds(mid)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Merges data[lo, mid) and data[mid, hi) front to back with the shorter left
+// run moved to the scratch buffer. After MIN_GALLOP consecutive wins of one
+// side the merge switches to galloping and moves whole blocks at a time,
+// until neither side wins a block of that size any more. Ties go to the left
+// run, which keeps the merge stable.
+template <std::random_access_iterator It, typename Less>
+void MergeLow(It data, std::size_t lo, std::size_t mid, std::size_t hi,
+              std::vector<std::iter_value_t<It>> &scratch, Less &less) {
+  scratch.assign(std::make_move_iterator(data + lo), std::make_move_iterator(data + mid));
+  std::size_t a = 0;
+  auto b = mid;
+  auto out = lo;
+  std::size_t winsLeft = 0;
+  std::size_t winsRight = 0;
+  while (a < scratch.size() && b < hi) {
+    if (winsLeft < MIN_GALLOP && winsRight < MIN_GALLOP) {
+      if (less(data[b], scratch[a])) {
+        data[out++] = std::ranges::iter_move(data + b++);
+        ++winsRight;
+        winsLeft = 0;
+      } else {
+        data[out++] = std::move(scratch[a++]);
+        ++winsLeft;
+        winsRight = 0;
+      }
+      continue;
+    }
+
+    auto leftEnd = GallopPartitionPoint(a, scratch.size(), false, [&](std::size_t i) {
+      return !less(data[b], scratch[i]);
+    });
+    winsLeft = leftEnd - a;
+    std::move(scratch.begin() + a, scratch.begin() + leftEnd, data + out);
+    out += winsLeft;
+    a = leftEnd;
+    if (a == scratch.size()) {
+      break;
+    }
+    data[out++] = std::ranges::iter_move(data + b++);
+    if (b == hi) {
+      break;
+    }
+
+    auto rightEnd = GallopPartitionPoint(b, hi, false, [&](std::size_t j) {
+      return less(data[j], scratch[a]);
+    });
+    winsRight = rightEnd - b;
+    std::move(data + b, data + rightEnd, data + out);
+    out += winsRight;
+    b = rightEnd;
+    if (b == hi) {
+      break;
+    }
+    data[out++] = std::move(scratch[a++]);
+  }
+  std::move(scratch.begin() + a, scratch.end(), data + out);
+  scratch.clear();
+}
+
+// Mirror image of MergeLow: the shorter right run goes to the scratch buffer
+// and the merge runs back to front.
+template <std::random_access_iterator It, typename Less>
+void MergeHigh(It data, std::size_t lo, std::size_t mid, std::size_t hi,
+               std::vector<std::iter_value_t<It>> &scratch, Less &less) {
+  scratch.assign(std::make_move_iterator(data + mid), std::make_move_iterator(data + hi));
+  auto a = mid;
+  auto b = scratch.size();
+  auto out = hi;
+  std::size_t winsLeft = 0;
+  std::size_t winsRight = 0;
+  while (a > lo && b > 0) {
+    if (winsLeft < MIN_GALLOP && winsRight < MIN_GALLOP) {
+      if (less(scratch[b - 1], data[a - 1])) {
+        data[--out] = std::ranges::iter_move(data + --a);
+        ++winsLeft;
+        winsRight = 0;
+      } else {
+        data[--out] = std::move(scratch[--b]);
+        ++winsRight;
+        winsLeft = 0;
+      }
+      continue;
+    }
+
+    auto rightBegin = GallopPartitionPoint(0, b, true, [&](std::size_t j) {
+      return less(scratch[j], data[a - 1]);
+    });
+    winsRight = b - rightBegin;
+    std::move_backward(scratch.begin() + rightBegin, scratch.begin() + b, data + out);
+    out -= winsRight;
+    b = rightBegin;
+    if (b == 0) {
+      break;
+    }
+    data[--out] = std::ranges::iter_move(data + --a);
+    if (a == lo) {
+      break;
+    }
+
+    auto leftBegin = GallopPartitionPoint(lo, a, true, [&](std::size_t i) {
+      return !less(scratch[b - 1], data[i]);
+    });
+    winsLeft = a - leftBegin;
+    std::move_backward(data + leftBegin, data + a, data + out);
+    out -= winsLeft;
+    a = leftBegin;
+    if (a == lo) {
+      break;
+    }
+    data[--out] = std::move(scratch[--b]);
+  }
+  std::move(scratch.begin(), scratch.begin() + b, data + (out - b));
+  scratch.clear();
+}
+
+// Merges two adjacent sorted runs. The prefix of the left run that is not
+// greater than the first element of the right run and the suffix of the
+// right run that is not smaller than the last element of the left run are
+// already in place and are skipped by galloping first.
+template <std::random_access_iterator It, typename Less>
+void MergeAdjacent(It data, std::size_t lo, std::size_t mid, std::size_t hi,
+                   std::vector<std::iter_value_t<It>> &scratch, Less &less) {
+  lo = GallopPartitionPoint(lo, mid, false, [&](std::size_t i) {
+    return !less(data[mid], data[i]);
+  });
+  if (lo == mid) {
+    return;
+  }
+  hi = GallopPartitionPoint(mid, hi, true, [&](std::size_t j) {
+    return less(data[j], data[mid - 1]);
+  });
+  if (mid - lo <= hi - mid) {
+    MergeLow(data, lo, mid, hi, scratch, less);
+  } else {
+    MergeHigh(data, lo, mid, hi, scratch, less);
+  }
+}
+
+// Run length below which natural runs are extended by binary insertion, as
+// in Timsort: between MIN_RUN / 2 and MIN_RUN, chosen so that the number of
+// runs is a power of two or slightly below one.
+inline std::size_t MinimumRun(std::size_t size) {
+  std::size_t remainder = 0;
+  while (size >= MIN_RUN) {
+    remainder |= size & 1;
+    size >>= 1;
+  }
+  return size + remainder;
+}
+
+// Length of the natural run starting at data[lo]. A strictly descending run is
+// reversed in place; reversing one with equal neighbours would break
+// stability, so those count as ascending runs.
+template <std::random_access_iterator It, typename Less>
+std::size_t NaturalRun(It data, std::size_t lo, std::size_t hi, Less &less) {
+  auto end = lo + 1;
+  if (end == hi) {
+    return 1;
+  }
+  if (less(data[end], data[lo])) {
+    while (end < hi && less(data[end], data[end - 1])) {
+      ++end;
+    }
+    std::reverse(data + lo, data + end);
+  } else {
+    while (end < hi && !less(data[end], data[end - 1])) {
+      ++end;
+    }
+  }
+  return end - lo;
+}
+
+// Extends the sorted data[lo, sorted) to data[lo, hi) by binary insertion,
+// placing each element after the ones equal to it.
+template <std::random_access_iterator It, typename Less>
+void BinaryInsertion(It data, std::size_t lo, std::size_t sorted, std::size_t hi, Less &less) {
+  for (; sorted < hi; ++sorted) {
+    std::iter_value_t<It> hole = std::ranges::iter_move(data + sorted);
+    auto position = std::upper_bound(data + lo, data + sorted, hole, less);
+    std::move_backward(position, data + sorted, data + (sorted + 1));
+    *position = std::move(hole);
+  }
+}
+
+// Stable sort that adapts to existing order: natural runs (strictly
+// descending ones reversed) are extended to MinimumRun by binary insertion and
+// merged with galloping under the Timsort stack invariants. Sorted input is a
+// single run and costs n - 1 comparisons. Merges only move the shorter run
+// into scratch, whose capacity is kept, so a buffer reused across calls
+// stops allocating once it has grown to half the largest input.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+void StableSort(Range &&range, std::vector<std::ranges::range_value_t<Range>> &scratch,
+                Compare compare = {}, Projection projection = {}) {
+  struct Run {
+    std::size_t begin;
+    std::size_t size;
+  };
+
+  auto data = std::ranges::begin(range);
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  auto less = MakeLess(compare, projection);
+  auto minimumRun = MinimumRun(size);
+
+  // Run sizes grow at least like Fibonacci numbers from the bottom of the
+  // stack, so 128 entries cover any size_t length.
+  std::array<Run, 128> runs;
+  std::size_t count = 0;
+  auto mergeAt = [&](std::size_t i) {
+    MergeAdjacent(data, runs[i].begin, runs[i + 1].begin, runs[i + 1].begin + runs[i + 1].size,
+                  scratch, less);
+    runs[i].size += runs[i + 1].size;
+    std::copy(runs.begin() + i + 2, runs.begin() + count, runs.begin() + i + 1);
+    --count;
+  };
+
+  for (std::size_t lo = 0; lo < size;) {
+    auto length = NaturalRun(data, lo, size, less);
+    if (length < minimumRun) {
+      auto forced = std::min(minimumRun, size - lo);
+      BinaryInsertion(data, lo, lo + length, lo + forced, less);
+      length = forced;
+    }
+    runs[count++] = {lo, length};
+    lo += length;
+
+    while (count > 1) {
+      auto n = count - 1;
+      if ((n >= 2 && runs[n - 2].size <= runs[n - 1].size + runs[n].size) ||
+          (n >= 3 && runs[n - 3].size <= runs[n - 2].size + runs[n - 1].size)) {
+        mergeAt(runs[n - 2].size < runs[n].size ? n - 2 : n - 1);
+      } else if (runs[n - 1].size <= runs[n].size) {
+        mergeAt(n - 1);
+      } else {
+        break;
+      }
+    }
+  }
+  while (count > 1) {
+    mergeAt(count - 2);
+  }
+}
+
+// StableSort with a per-thread scratch buffer for each element type, so
+// repeated calls on one thread allocate only while the inputs keep growing.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+void StableSort(Range &&range, Compare compare = {}, Projection projection = {}) {
+  thread_local std::vector<std::ranges::range_value_t<Range>> scratch;
+  StableSort(range, scratch, compare, projection);
+}
+
+// Stable argsort: the permutation that sorts keys, so that
+// keys[order[0]], keys[order[1]], ... is in order and equal keys keep their
+// relative order. Arithmetic keys in their natural order are radix sorted as
+// (image, index) pairs, everything else sorts the indices with StableSort.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+std::vector<std::size_t> ArgSort(const Range &keys, Compare compare = {},
+                                 Projection projection = {}) {
+  auto data = std::ranges::begin(keys);
+  auto size = static_cast<std::size_t>(std::ranges::size(keys));
+  using T = std::ranges::range_value_t<Range>;
+  std::vector<std::size_t> order(size);
+
+  if constexpr (RadixKey<T> && NaturalOrder<decltype(MakeLess(compare, projection)), T>) {
+    if (size >= RADIX_THRESHOLD) {
+      using Bits = decltype(RadixImage(T{}));
+      std::vector<std::pair<Bits, std::size_t>> entries(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        auto key = static_cast<T>(data[i]);
+        if constexpr (std::floating_point<T>) {
+          // -0.0 == +0.0, so both must share an image to keep their order.
+          key = key == 0 ? T(0) : key;
+        }
+        entries[i] = {RadixImage(key), i};
+      }
+      RadixSortBy(entries.begin(), size, [](const auto &entry) { return entry.first; });
+      for (std::size_t i = 0; i < size; ++i) {
+        order[i] = entries[i].second;
+      }
+      return order;
+    }
+  }
+
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  StableSort(order, compare, [&](std::size_t index) -> decltype(auto) {
+    return std::invoke(projection, data[index]);
+  });
+  return order;
+}
+
+// Sorts the key column and permutes every value column along with it in
+// place, for data kept as parallel vectors instead of a vector of structs.
+// The permutation is computed once by ArgSort and then applied to all
+// columns in a single pass over its cycles.
+template <typename Keys, typename... Values>
+  requires SortableRange<Keys, std::ranges::less, std::identity> &&
+           (std::ranges::random_access_range<Values> && ...)
+void SortByKey(Keys &&keys, Values &&...values) {
+  auto size = static_cast<std::size_t>(std::ranges::size(keys));
+  assert(((static_cast<std::size_t>(std::ranges::size(values)) == size) && ...));
+  if constexpr (sizeof...(Values) == 0) {
+    Sort(keys);
+  } else {
+    auto order = ArgSort(keys);
+    ApplyPermutation(order, std::ranges::begin(keys), std::ranges::begin(values)...);
+  }
+}
+
+// Sorts by an expensive comparator with the help of a cheap key computed
+// once per element, such as a double approximating a fraction. The key has to
+// agree with the order wherever it can tell elements apart: key(a) < key(b)
+// must imply that a sorts before b. The keys are sorted together with the
+// indices of their elements as (key, index) pairs, which radix sorts
+// arithmetic keys, and compare only runs inside the runs of pairs whose keys
+// tie. The elements themselves are moved once, by ApplyPermutation at the
+// end, so they need not be copyable; it is not stable.
+template <typename Range, typename Key, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection> &&
+           std::totally_ordered<std::invoke_result_t<
+               Key &, std::indirect_result_t<Projection &, std::ranges::iterator_t<Range>>>>
+void SortCached(Range &&range, Key key, Compare compare = {}, Projection projection = {}) {
+  auto data = std::ranges::begin(range);
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  using K = std::invoke_result_t<Key &, std::indirect_result_t<Projection &, decltype(data)>>;
+  std::vector<std::pair<K, std::size_t>> entries;
+  entries.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    entries.emplace_back(std::invoke(key, std::invoke(projection, data[i])), i);
+  }
+
+  if constexpr (RadixKey<K>) {
+    RadixSortBy(entries.begin(), size, [](const auto &entry) { return RadixImage(entry.first); });
+  } else {
+    Sort(entries, {}, &std::pair<K, std::size_t>::first);
+  }
+  auto element = [&](const std::pair<K, std::size_t> &entry) -> decltype(auto) {
+    return std::invoke(projection, data[entry.second]);
+  };
+  for (std::size_t first = 0; first < size;) {
+    auto last = first + 1;
+    while (last < size && entries[last].first == entries[first].first) {
+      ++last;
+    }
+    if (last - first > 1) {
+      Sort(std::span(entries).subspan(first, last - first), compare, element);
+    }
+    first = last;
+  }
+
+  std::vector<std::size_t> order(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    order[i] = entries[i].second;
+  }
+  entries = {};
+  ApplyPermutation(order, data);
+}
+
+// Sorted multiset for bursts of inserts between lookups, organized like a
+// log-structured merge tree. Inserts are appended to an unsorted batch;
+// a full batch is sorted with Sort and merged into level 0, and a level that
+// outgrows LEVEL_GROWTH times the capacity of the one below it is merged one
+// level up. Each element is thus moved once per level, O(log n) amortized.
+// Queries search the batch (sorted on demand) and every level; Compact()
+// merges everything into a single contiguous array.
+template <std::copyable T, typename Compare = std::ranges::less>
+  requires std::sortable<typename std::vector<T>::iterator, Compare>
+class SortedVector {
+public:
+  explicit SortedVector(std::size_t batchSize = LSM_BATCH_SIZE, Compare compare = {})
+      : batchSize_(std::max<std::size_t>(batchSize, 1)), compare_(std::move(compare)) {
+    batch_.reserve(batchSize_);
+  }
+
+  std::size_t Size() const {
+    auto size = batch_.size();
+    for (auto &level : levels_) {
+      size += level.size();
+    }
+    return size;
+  }
+
+  std::size_t Levels() const { return levels_.size(); }
+
+  void Insert(const T &value) {
+    batch_.push_back(value);
+    batchSorted_ = false;
+    if (batch_.size() == batchSize_) {
+      Flush();
+    }
+  }
+
+  template <std::ranges::input_range Values>
+    requires std::convertible_to<std::ranges::range_reference_t<Values>, const T &>
+  void Insert(Values &&values) {
+    for (auto &&value : values) {
+      Insert(value);
+    }
+  }
+
+  // The smallest element not less than value, or nullptr if there is none.
+  const T *LowerBound(const T &value) {
+    SortBatch();
+    const T *best = nullptr;
+    ForEachRun([&](const std::vector<T> &run) {
+      auto found = std::ranges::lower_bound(run, value, compare_);
+      if (found != run.end() && (best == nullptr || std::invoke(compare_, *found, *best))) {
+        best = &*found;
+      }
+    });
+    return best;
+  }
+
+  bool Contains(const T &value) {
+    auto *found = LowerBound(value);
+    return found != nullptr && !std::invoke(compare_, value, *found);
+  }
+
+  // Number of elements in [lo, hi).
+  std::size_t Count(const T &lo, const T &hi) {
+    SortBatch();
+    std::size_t count = 0;
+    ForEachRun([&](const std::vector<T> &run) {
+      auto [first, last] = Bounds(run, lo, hi);
+      count += static_cast<std::size_t>(last - first);
+    });
+    return count;
+  }
+
+  // The elements in [lo, hi) in order, merged from all levels.
+  std::vector<T> Range(const T &lo, const T &hi) {
+    SortBatch();
+    std::vector<T> result;
+    ForEachRun([&](const std::vector<T> &run) {
+      auto [first, last] = Bounds(run, lo, hi);
+      auto middle = result.insert(result.end(), first, last);
+      std::inplace_merge(result.begin(), middle, result.end(), compare_);
+    });
+    return result;
+  }
+
+  // Merges the batch and all levels into one sorted array and returns it.
+  std::span<const T> Compact() {
+    Flush();
+    while (levels_.size() > 1) {
+      MergeInto(levels_.back(), levels_[levels_.size() - 2]);
+      levels_.pop_back();
+    }
+    return levels_.empty() ? std::span<const T>() : std::span<const T>(levels_[0]);
+  }
+
+private:
+  void SortBatch() {
+    if (!batchSorted_) {
+      Sort(batch_, compare_);
+      batchSorted_ = true;
+    }
+  }
+
+  // Sorts the batch into level 0 and cascades every level that grew past its
+  // capacity into the next one.
+  void Flush() {
+    if (batch_.empty()) {
+      return;
+    }
+    SortBatch();
+    if (levels_.empty()) {
+      levels_.emplace_back();
+    }
+    MergeInto(batch_, levels_[0]);
+    batch_.clear();
+
+    auto capacity = batchSize_ * LEVEL_GROWTH;
+    for (std::size_t level = 0; levels_[level].size() > capacity; ++level) {
+      if (level + 1 == levels_.size()) {
+        levels_.emplace_back();
+      }
+      MergeInto(levels_[level], levels_[level + 1]);
+      levels_[level].clear();
+      capacity *= LEVEL_GROWTH;
+    }
+  }
+
+  // target = merge(source, target); the merged array is built in a scratch
+  // vector whose storage then changes places with target's.
+  void MergeInto(const std::vector<T> &source, std::vector<T> &target) {
+    scratch_.clear();
+    scratch_.reserve(source.size() + target.size());
+    std::ranges::merge(source, target, std::back_inserter(scratch_), compare_);
+    std::swap(scratch_, target);
+  }
+
+  template <typename Visit> void ForEachRun(Visit visit) const {
+    visit(batch_);
+    for (auto &level : levels_) {
+      visit(level);
+    }
+  }
+
+  auto Bounds(const std::vector<T> &run, const T &lo, const T &hi) const {
+    auto first = std::ranges::lower_bound(run, lo, compare_);
+    auto last = std::ranges::lower_bound(first, run.end(), hi, compare_);
+    return std::pair(first, last);
+  }
+
+  std::size_t batchSize_;
+  Compare compare_;
+  std::vector<T> batch_;
+  bool batchSorted_ = true;
+  std::vector<std::vector<T>> levels_;
+  std::vector<T> scratch_;
+};
+
+// Every participant owns a deque: it pushes and pops its own tasks at the
+// back and steals the oldest (largest) tasks from the front of the others.
+// The thread that calls Run() is participant 0, so a pool of N threads starts
+// N - 1 workers.
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(std::size_t threadCount)
+      : queues_(std::max<std::size_t>(threadCount, 1)) {
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      threads_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  std::size_t Size() const { return queues_.size(); }
+
+  template <typename Task> void Run(Task root) {
+    auto *previousPool = currentPool_;
+    auto previousIndex = currentIndex_;
+    currentPool_ = this;
+    currentIndex_ = 0;
+    root();
+    while (pending_ > 0) {
+      if (!TryRun(0)) {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return queued_ > 0 || pending_ == 0; });
+      }
+    }
+    currentPool_ = previousPool;
+    currentIndex_ = previousIndex;
+  }
+
+  void Submit(std::function<void()> task) {
+    auto index = currentPool_ == this ? currentIndex_ : 0;
+    ++pending_;
+    {
+      std::lock_guard lock(queues_[index].mutex);
+      queues_[index].tasks.push_back(std::move(task));
+    }
+    ++queued_;
+    std::lock_guard lock(mutex_);
+    wake_.notify_one();
+  }
+
+  // Runs body(0) ... body(count - 1) and returns once all of them finished.
+  // The calling participant keeps executing queued tasks while it waits, so
+  // nested calls cannot deadlock.
+  template <typename Body> void ParallelFor(std::size_t count, Body body) {
+    std::atomic<std::size_t> remaining = count;
+    for (std::size_t i = 1; i < count; ++i) {
+      Submit([&body, &remaining, i] {
+        body(i);
+        --remaining;
+      });
+    }
+    if (count > 0) {
+      body(0);
+      --remaining;
+    }
+    auto self = currentPool_ == this ? currentIndex_ : 0;
+    while (remaining > 0) {
+      if (!TryRun(self)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool TryRun(std::size_t self) {
+    std::function<void()> task;
+    for (std::size_t offset = 0; offset < queues_.size() && !task; ++offset) {
+      auto &queue = queues_[(self + offset) % queues_.size()];
+      std::lock_guard lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      if (offset == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+    if (!task) {
+      return false;
+    }
+    --queued_;
+    task();
+    if (--pending_ == 0) {
+      std::lock_guard lock(mutex_);
+      wake_.notify_all();
+    }
+    return true;
+  }
+
+  void WorkerLoop(std::size_t index) {
+    currentPool_ = this;
+    currentIndex_ = index;
+    while (true) {
+      if (TryRun(index)) {
+        continue;
+      }
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+      if (stopping_) {
+        return;
+      }
+    }
+  }
+
+  static inline thread_local WorkStealingPool *currentPool_ = nullptr;
+  static inline thread_local std::size_t currentIndex_ = 0;
+
+  std::vector<Queue> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::atomic<std::size_t> queued_ = 0;
+  std::atomic<std::size_t> pending_ = 0;
+  bool stopping_ = false;
+};
+
+// Moves the elements of [left, right) that satisfy the predicate to the front
+// and returns their number. Blocks have a fixed size, so the resulting layout
+// does not depend on the number of threads or on scheduling.
+template <std::random_access_iterator It, typename Predicate>
+std::size_t ParallelPartitionBy(WorkStealingPool &pool, It data,
+                                std::size_t left, std::size_t right,
+                                Predicate predicate) {
+  auto blocks = (right - left + PARTITION_BLOCK_SIZE - 1) / PARTITION_BLOCK_SIZE;
+  std::vector<std::size_t> counts(blocks);
+  pool.ParallelFor(blocks, [&](std::size_t block) {
+    auto begin = data + (left + block * PARTITION_BLOCK_SIZE);
+    auto end = data + std::min(left + (block + 1) * PARTITION_BLOCK_SIZE, right);
+    counts[block] = std::partition(begin, end, predicate) - begin;
+  });
+
+  std::size_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  auto middle = left + total;
+
+  // Rejected elements left of middle and accepted elements right of it come
+  // in equal numbers; collect both as interval lists and swap them pairwise.
+  std::vector<std::pair<std::size_t, std::size_t>> misplacedLeft;
+  std::vector<std::pair<std::size_t, std::size_t>> misplacedRight;
+  for (std::size_t block = 0; block < blocks; ++block) {
+    auto begin = left + block * PARTITION_BLOCK_SIZE;
+    auto end = std::min(begin + PARTITION_BLOCK_SIZE, right);
+    auto split = begin + counts[block];
+    if (split < middle) {
+      misplacedLeft.emplace_back(split, std::min(end, middle));
+    }
+    if (std::max(begin, middle) < split) {
+      misplacedRight.emplace_back(std::max(begin, middle), split);
+    }
+  }
+
+  std::vector<std::size_t> offsetsLeft = {0};
+  std::vector<std::size_t> offsetsRight = {0};
+  for (auto [begin, end] : misplacedLeft) {
+    offsetsLeft.push_back(offsetsLeft.back() + end - begin);
+  }
+  for (auto [begin, end] : misplacedRight) {
+    offsetsRight.push_back(offsetsRight.back() + end - begin);
+  }
+  auto misplaced = offsetsLeft.back();
+  assert(misplaced == offsetsRight.back());
+
+  auto locate = [](const auto &intervals, const auto &offsets, std::size_t rank) {
+    auto interval = std::upper_bound(offsets.begin(), offsets.end(), rank) - offsets.begin() - 1;
+    return std::pair<std::size_t, std::size_t>(
+        interval, intervals[interval].first + rank - offsets[interval]);
+  };
+
+  auto chunks = (misplaced + PARTITION_BLOCK_SIZE - 1) / PARTITION_BLOCK_SIZE;
+  pool.ParallelFor(chunks, [&](std::size_t chunk) {
+    auto rank = chunk * PARTITION_BLOCK_SIZE;
+    auto last = std::min(rank + PARTITION_BLOCK_SIZE, misplaced);
+    auto [intervalLeft, i] = locate(misplacedLeft, offsetsLeft, rank);
+    auto [intervalRight, j] = locate(misplacedRight, offsetsRight, rank);
+    for (; rank < last; ++rank) {
+      if (i == misplacedLeft[intervalLeft].second) {
+        i = misplacedLeft[++intervalLeft].first;
+      }
+      if (j == misplacedRight[intervalRight].second) {
+        j = misplacedRight[++intervalRight].first;
+      }
+      std::ranges::iter_swap(data + i++, data + j++);
+    }
+  });
+  return total;
+}
+
+// Places the chosen pivot at its final position using all workers and
+// returns [lessEnd, greaterBegin): everything before lessEnd is smaller than
+// the pivot, everything from greaterBegin on is not smaller, and the elements
+// between them are equal to the pivot.
+template <std::random_access_iterator It, typename Less>
+std::pair<std::size_t, std::size_t>
+ParallelPartition(WorkStealingPool &pool, It data, std::size_t left,
+                  std::size_t right, Less &less) {
+  ChoosePivot(data, left, right, less);
+
+  auto &&pivot = data[left];
+  auto smaller = ParallelPartitionBy(pool, data, left + 1, right,
+                                     [&](auto &&value) { return less(value, pivot); });
+  if (smaller > 0) {
+    std::ranges::iter_swap(data + left, data + (left + smaller));
+    return {left + smaller, left + smaller + 1};
+  }
+
+  // The pivot is the minimum, so gather its duplicates instead of peeling a
+  // single element off the range.
+  auto equal = ParallelPartitionBy(pool, data, left + 1, right,
+                                   [&](auto &&value) { return !less(pivot, value); });
+  return {left, left + 1 + equal};
+}
+
+template <std::random_access_iterator It, typename Less>
+void ParallelSplit(WorkStealingPool &pool, It data, std::size_t left,
+                   std::size_t right, std::size_t depth, Less &less) {
+  while (right - left > PARALLEL_THRESHOLD && depth > 0) {
+    --depth;
+    std::pair<std::size_t, std::size_t> bounds;
+    if (right - left >= PARALLEL_PARTITION_THRESHOLD) {
+      bounds = ParallelPartition(pool, data, left, right, less);
+    } else {
+      ChoosePivot(data, left, right, less);
+      if (left > 0 && !less(data[left - 1], data[left])) {
+        bounds = {left, PartitionEqual(data, left, right, less) + 1};
+      } else {
+        auto pivotIndex = Partition(data, left, right, less).first;
+        bounds = {pivotIndex, pivotIndex + 1};
+      }
+    }
+    pool.Submit([&pool, data, begin = bounds.second, right, depth, &less] {
+      ParallelSplit(pool, data, begin, right, depth, less);
+    });
+    right = bounds.first;
+  }
+  Split(data, left, right, depth, less);
+}
+
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+void Sort(Range &&range, std::size_t threadCount, Compare compare = {},
+          Projection projection = {}) {
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  if (threadCount <= 1 || size <= PARALLEL_THRESHOLD) {
+    Sort(range, compare, projection);
+    return;
+  }
+
+  auto data = std::ranges::begin(range);
+  auto less = MakeLess(compare, projection);
+  if (OrderRun(data, size, less)) {
+    return;
+  }
+  WorkStealingPool pool(threadCount);
+  pool.Run([&] { ParallelSplit(pool, data, 0, size, DepthLimit(size), less); });
+}
+
+template <std::random_access_iterator It, typename Less>
+void SelectRange(It data, std::size_t left, std::size_t right, std::size_t k,
+                 std::size_t depth, Less &less);
+
+// Moves a pivot with a linear worst-case guarantee to data[left]: the
+// medians of groups of five are gathered at the front and their median is
+// selected recursively. At least three of every ten elements lie on either
+// side of it, and the other gathered medians serve as the sentinel the
+// partition scans need.
+template <std::random_access_iterator It, typename Less>
+void ChooseMedianOfMedians(It data, std::size_t left, std::size_t right, Less &less) {
+  auto groups = (right - left) / 5;
+  for (std::size_t group = 0; group < groups; ++group) {
+    auto first = left + 5 * group;
+    Order(data, first, first + 5, less);
+    std::ranges::iter_swap(data + (left + group), data + (first + 2));
+  }
+  SelectRange(data, left, left + groups, left + groups / 2, DepthLimit(groups), less);
+  std::ranges::iter_swap(data + left, data + (left + groups / 2));
+}
+
+// Introselect: quickselect that descends only into the side holding index k,
+// so nothing of the discarded side is ever touched again. Once depth
+// partitions have been spent, pivots come from ChooseMedianOfMedians, which
+// bounds the total work by O(n).
+template <std::random_access_iterator It, typename Less>
+void SelectRange(It data, std::size_t left, std::size_t right, std::size_t k,
+                 std::size_t depth, Less &less) {
+  while (right - left > LEAF_THRESHOLD<std::iter_value_t<It>>) {
+    if (depth == 0) {
+      ChooseMedianOfMedians(data, left, right, less);
+    } else {
+      --depth;
+      ChoosePivot(data, left, right, less);
+    }
+
+    // As in Split, a pivot equal to the element before the range is the
+    // minimum, and every copy of it is already in its final place.
+    if (left > 0 && !less(data[left - 1], data[left])) {
+      auto last = PartitionEqual(data, left, right, less);
+      if (k <= last) {
+        return;
+      }
+      left = last + 1;
+      continue;
+    }
+
+    auto pivotIndex = Partition(data, left, right, less).first;
+    if (k == pivotIndex) {
+      return;
+    }
+    if (k < pivotIndex) {
+      right = pivotIndex;
+    } else {
+      left = pivotIndex + 1;
+    }
+  }
+  SortLeaf(data, left, right, less);
+}
+
+// Rearranges the range like std::ranges::nth_element: the element at index k
+// is the one a full sort would put there, nothing before it is greater and
+// nothing after it is smaller. Returns an iterator to it, or the end when k is
+// out of range.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+std::ranges::borrowed_iterator_t<Range> Select(Range &&range, std::size_t k,
+                                               Compare compare = {},
+                                               Projection projection = {}) {
+  auto data = std::ranges::begin(range);
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  if (k >= size) {
+    return std::ranges::next(data, std::ranges::end(range));
+  }
+  auto less = MakeLess(compare, projection);
+  SelectRange(data, 0, size, k, DepthLimit(size), less);
+  return data + k;
+}
+
+// Puts the k smallest elements in sorted order at the front of the range;
+// the order of the rest is unspecified. One selection descent isolates them
+// and only they are then sorted.
+template <typename Range, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires SortableRange<Range, Compare, Projection>
+void PartialSort(Range &&range, std::size_t k, Compare compare = {},
+                 Projection projection = {}) {
+  auto data = std::ranges::begin(range);
+  auto size = static_cast<std::size_t>(std::ranges::size(range));
+  k = std::min(k, size);
+  if (k < size) {
+    auto less = MakeLess(compare, projection);
+    SelectRange(data, 0, size, k, DepthLimit(size), less);
+  }
+  Sort(std::ranges::subrange(data, data + k), compare, projection);
+}
+
+// Keeps the k smallest of all values pushed so far, for inputs that arrive in
+// chunks and are never held in memory at once. The candidates form a max-heap
+// of at most k elements whose root is the current threshold, so a value that
+// does not beat it costs a single comparison.
+template <std::copyable T, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires std::sortable<typename std::vector<T>::iterator, Compare, Projection>
+class TopK {
+public:
+  explicit TopK(std::size_t k, Compare compare = {}, Projection projection = {})
+      : k_(k), compare_(std::move(compare)), projection_(std::move(projection)) {
+    heap_.reserve(k);
+  }
+
+  void Push(const T &value) {
+    auto less = MakeLess(compare_, projection_);
+    if (heap_.size() < k_) {
+      heap_.push_back(value);
+      auto child = heap_.size() - 1;
+      while (child > 0 && less(heap_[(child - 1) / 2], heap_[child])) {
+        std::swap(heap_[(child - 1) / 2], heap_[child]);
+        child = (child - 1) / 2;
+      }
+    } else if (k_ > 0 && less(value, heap_[0])) {
+      heap_[0] = value;
+      SiftDown(heap_.begin(), 0, k_, 0, less);
+    }
+  }
+
+  template <std::ranges::input_range Chunk>
+    requires std::convertible_to<std::ranges::range_reference_t<Chunk>, const T &>
+  void Push(Chunk &&chunk) {
+    for (auto &&value : chunk) {
+      Push(value);
+    }
+  }
+
+  std::size_t Size() const { return heap_.size(); }
+
+  // The kept values in ascending order; the collector is empty afterwards.
+  std::vector<T> Take() {
+    auto result = std::move(heap_);
+    heap_.clear();
+    Sort(result, compare_, projection_);
+    return result;
+  }
+
+private:
+  std::size_t k_;
+  Compare compare_;
+  Projection projection_;
+  std::vector<T> heap_;
+};
+
+#ifdef __linux__
+struct ExternalSortOptions {
+  // Upper bound for all record buffers of the sort, in bytes.
+  std::size_t memoryBudget = std::size_t(1) << 28;
+  // Threads used to sort each chunk in memory.
+  std::size_t threadCount = 1;
+  // Where sorted runs are spilled; the system default when empty.
+  std::string temporaryDirectory;
+};
+
+// Owns a file descriptor. Temporary files are unlinked right after they are
+// created, so they disappear with the descriptor even if the sort throws.
+class FileHandle {
+public:
+  FileHandle() = default;
+  explicit FileHandle(int descriptor) : descriptor_(descriptor) {}
+
+  FileHandle(FileHandle &&other) noexcept
+      : descriptor_(std::exchange(other.descriptor_, -1)) {}
+  FileHandle &operator=(FileHandle &&other) noexcept {
+    std::swap(descriptor_, other.descriptor_);
+    return *this;
+  }
+
+  ~FileHandle() {
+    if (descriptor_ >= 0) {
+      close(descriptor_);
+    }
+  }
+
+  static FileHandle Open(const std::string &path, int flags) {
+    int descriptor = open(path.c_str(), flags | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    return FileHandle(descriptor);
+  }
+
+  static FileHandle Temporary(const std::string &directory) {
+    auto path = (directory.empty() ? std::filesystem::temp_directory_path().string()
+                                   : directory) +
+                "/sort-run-XXXXXX";
+    int descriptor = mkostemp(path.data(), O_CLOEXEC);
+    if (descriptor < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    unlink(path.c_str());
+    return FileHandle(descriptor);
+  }
+
+  std::size_t Size() const {
+    struct stat status {};
+    if (fstat(descriptor_, &status) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    return static_cast<std::size_t>(status.st_size);
+  }
+
+  // Whether path names this same file, through any link; false when nothing
+  // exists at path.
+  bool SameFile(const std::string &path) const {
+    struct stat own {};
+    struct stat other {};
+    if (fstat(descriptor_, &own) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    return stat(path.c_str(), &other) == 0 && own.st_dev == other.st_dev &&
+           own.st_ino == other.st_ino;
+  }
+
+  // Announces a front-to-back scan so the kernel reads ahead aggressively.
+  void AdviseSequential() const {
+    posix_fadvise(descriptor_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
+  void Read(void *buffer, std::size_t bytes, std::size_t offset) const {
+    auto *target = static_cast<char *>(buffer);
+    while (bytes > 0) {
+      auto done = pread(descriptor_, target, bytes, static_cast<off_t>(offset));
+      if (done <= 0) {
+        if (done < 0 && errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(done < 0 ? errno : EIO, std::generic_category(), "pread");
+      }
+      target += done;
+      bytes -= static_cast<std::size_t>(done);
+      offset += static_cast<std::size_t>(done);
+    }
+  }
+
+  void Write(const void *buffer, std::size_t bytes, std::size_t offset) const {
+    const auto *source = static_cast<const char *>(buffer);
+    while (bytes > 0) {
+      auto done = pwrite(descriptor_, source, bytes, static_cast<off_t>(offset));
+      if (done < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+      }
+      source += done;
+      bytes -= static_cast<std::size_t>(done);
+      offset += static_cast<std::size_t>(done);
+    }
+  }
+
+private:
+  int descriptor_ = -1;
+};
+
+// A sorted sequence of records spilled to a temporary file.
+struct SortedRun {
+  FileHandle file;
+  std::size_t size = 0;
+};
+
+// Streams a run front to back through the two halves of its buffer: while
+// the merge consumes one half, the next block of the run is read into the
+// other in the background.
+template <typename T> class RunReader {
+public:
+  RunReader(const SortedRun &run, std::span<T> buffer)
+      : run_(&run), current_(buffer.first(buffer.size() / 2)),
+        next_(buffer.subspan(buffer.size() / 2, buffer.size() / 2)) {
+    run.file.AdviseSequential();
+    Prefetch();
+    Refill();
+  }
+
+  bool Empty() const { return position_ == end_; }
+  const T &Front() const { return current_[position_]; }
+
+  void Pop() {
+    if (++position_ == end_) {
+      Refill();
+    }
+  }
+
+private:
+  // Starts reading the next block of the run into next_, if any is left.
+  void Prefetch() {
+    prefetched_ = std::min(next_.size(), run_->size - requested_);
+    if (prefetched_ == 0) {
+      return;
+    }
+    pending_ = std::async(std::launch::async,
+                          [&file = run_->file, block = next_.first(prefetched_),
+                           offset = requested_] {
+                            file.Read(block.data(), block.size_bytes(), offset * sizeof(T));
+                          });
+    requested_ += prefetched_;
+  }
+
+  void Refill() {
+    position_ = 0;
+    end_ = 0;
+    if (!pending_.valid()) {
+      return;
+    }
+    pending_.get();
+    std::swap(current_, next_);
+    end_ = prefetched_;
+    Prefetch();
+  }
+
+  const SortedRun *run_;
+  std::span<T> current_;
+  std::span<T> next_;
+  std::future<void> pending_;
+  std::size_t requested_ = 0;
+  std::size_t prefetched_ = 0;
+  std::size_t position_ = 0;
+  std::size_t end_ = 0;
+};
+
+// Tournament tree over k sources. Internal node n keeps the loser of the
+// match played there and tree_[0] the overall winner, so replacing the winner
+// replays only the log k matches on its path. Exhausted sources lose every
+// match and ties go to the lower index.
+template <typename T, typename Less> class LoserTree {
+public:
+  LoserTree(std::vector<RunReader<T>> &readers, Less &less)
+      : readers_(readers), less_(less), tree_(readers.size()) {
+    tree_[0] = Build(1);
+  }
+
+  std::size_t Winner() const { return tree_[0]; }
+
+  void Replay() {
+    auto winner = tree_[0];
+    for (auto node = (winner + tree_.size()) / 2; node > 0; node /= 2) {
+      if (Beats(tree_[node], winner)) {
+        std::swap(tree_[node], winner);
+      }
+    }
+    tree_[0] = winner;
+  }
+
+private:
+  bool Beats(std::size_t a, std::size_t b) const {
+    if (readers_[a].Empty()) {
+      return false;
+    }
+    if (readers_[b].Empty()) {
+      return true;
+    }
+    auto &lhs = readers_[a].Front();
+    auto &rhs = readers_[b].Front();
+    return less_(lhs, rhs) || (!less_(rhs, lhs) && a < b);
+  }
+
+  std::size_t Build(std::size_t node) {
+    if (node >= tree_.size()) {
+      return node - tree_.size();
+    }
+    auto left = Build(2 * node);
+    auto right = Build(2 * node + 1);
+    if (Beats(left, right)) {
+      tree_[node] = right;
+      return left;
+    }
+    tree_[node] = left;
+    return right;
+  }
+
+  std::vector<RunReader<T>> &readers_;
+  Less &less_;
+  std::vector<std::size_t> tree_;
+};
+
+// Merges the runs into output. The arena is split into two input blocks per
+// run and two output blocks, so the next block of every run is read and a
+// full output block is written in the background while the others are used.
+template <typename T, typename Less>
+void MergeRuns(std::span<SortedRun> runs, const FileHandle &output,
+               std::span<T> arena, Less &less) {
+  auto block = arena.size() / (2 * runs.size() + 2);
+  std::vector<RunReader<T>> readers;
+  readers.reserve(runs.size());
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    readers.emplace_back(runs[i], arena.subspan(2 * i * block, 2 * block));
+  }
+  auto filling = arena.subspan(2 * runs.size() * block, block);
+  auto flushing = arena.subspan((2 * runs.size() + 1) * block, block);
+
+  std::size_t total = 0;
+  for (auto &run : runs) {
+    total += run.size;
+  }
+
+  LoserTree<T, Less> tree(readers, less);
+  std::future<void> pending;
+  std::size_t written = 0;
+  std::size_t filled = 0;
+  auto flush = [&] {
+    if (pending.valid()) {
+      pending.get();
+    }
+    std::swap(filling, flushing);
+    pending = std::async(std::launch::async, [&output, block = flushing.first(filled), written] {
+      output.Write(block.data(), block.size_bytes(), written * sizeof(T));
+    });
+    written += filled;
+    filled = 0;
+  };
+
+  for (std::size_t merged = 0; merged < total; ++merged) {
+    auto winner = tree.Winner();
+    filling[filled++] = readers[winner].Front();
+    readers[winner].Pop();
+    tree.Replay();
+    if (filled == block) {
+      flush();
+    }
+  }
+  if (filled > 0) {
+    flush();
+  }
+  if (pending.valid()) {
+    pending.get();
+  }
+}
+
+// Sorts a file of fixed-width records that may be much larger than memory.
+// Chunks of the input are sorted in memory with Sort and spilled as runs,
+// which a loser tree then merges, in several passes if there are more runs
+// than the budget has room for input blocks. Record buffers never exceed
+// options.memoryBudget: run formation keeps four chunk-sized areas (the next
+// chunk being read ahead, the chunk being sorted, the previous one being
+// written behind it and the scratch the radix engine may take), and merging
+// splits the whole budget into blocks. Throws std::invalid_argument when
+// outputPath names the input file, which the output would truncate.
+template <typename T, typename Compare = std::ranges::less,
+          typename Projection = std::identity>
+  requires std::is_trivially_copyable_v<T> && std::default_initializable<T> &&
+           std::sortable<T *, Compare, Projection>
+void ExternalSort(const std::string &inputPath, const std::string &outputPath,
+                  const ExternalSortOptions &options = {}, Compare compare = {},
+                  Projection projection = {}) {
+  auto budget = options.memoryBudget / sizeof(T);
+  if (budget < 6) {
+    throw std::invalid_argument("ExternalSort: memory budget below six records");
+  }
+
+  auto input = FileHandle::Open(inputPath, O_RDONLY);
+  auto bytes = input.Size();
+  if (bytes % sizeof(T) != 0) {
+    throw std::invalid_argument("ExternalSort: " + inputPath +
+                                " is not a whole number of records");
+  }
+  auto records = bytes / sizeof(T);
+  input.AdviseSequential();
+  if (input.SameFile(outputPath)) {
+    throw std::invalid_argument("ExternalSort: " + outputPath + " is the input file");
+  }
+  auto output = FileHandle::Open(outputPath, O_WRONLY | O_CREAT | O_TRUNC);
+  if (records == 0) {
+    return;
+  }
+
+  auto chunk = budget / 4;
+  std::vector<SortedRun> runs;
+  {
+    std::vector<T> reading;
+    std::vector<T> sorting;
+    std::vector<T> writing;
+    std::future<void> pendingRead;
+    std::future<void> pendingWrite;
+    auto readAhead = [&](std::size_t offset) {
+      reading.resize(std::min(chunk, records - offset));
+      pendingRead = std::async(std::launch::async, [&input, block = std::span(reading), offset] {
+        input.Read(block.data(), block.size_bytes(), offset * sizeof(T));
+      });
+    };
+    readAhead(0);
+    for (std::size_t offset = 0; offset < records; offset += chunk) {
+      pendingRead.get();
+      std::swap(reading, sorting);
+      if (offset + chunk < records) {
+        readAhead(offset + chunk);
+      }
+      auto count = sorting.size();
+      Sort(sorting, options.threadCount, compare, projection);
+
+      if (pendingWrite.valid()) {
+        pendingWrite.get();
+      }
+      std::swap(sorting, writing);
+      if (count == records) {
+        output.Write(writing.data(), count * sizeof(T), 0);
+        return;
+      }
+      runs.push_back({FileHandle::Temporary(options.temporaryDirectory), count});
+      pendingWrite = std::async(std::launch::async, [&file = runs.back().file, &writing] {
+        file.Write(writing.data(), writing.size() * sizeof(T), 0);
+      });
+    }
+    if (pendingWrite.valid()) {
+      pendingWrite.get();
+    }
+  }
+
+  // Input blocks below EXTERNAL_BLOCK_SIZE bytes turn the merge into seeks, so
+  // the fan-in is capped to keep them at least that large where possible. Each
+  // run takes two blocks and the output another two.
+  auto minimumBlock = std::max<std::size_t>(EXTERNAL_BLOCK_SIZE / sizeof(T), 1);
+  minimumBlock = std::min(minimumBlock, budget / 6);
+  auto fanIn = (budget / minimumBlock - 2) / 2;
+
+  auto less = MakeLess(compare, projection);
+  std::vector<T> arena(budget);
+  while (runs.size() > fanIn) {
+    std::vector<SortedRun> merged;
+    for (std::size_t first = 0; first < runs.size(); first += fanIn) {
+      auto group = std::span(runs).subspan(first, std::min(fanIn, runs.size() - first));
+      if (group.size() == 1) {
+        merged.push_back(std::move(group[0]));
+        continue;
+      }
+      SortedRun run{FileHandle::Temporary(options.temporaryDirectory), 0};
+      for (auto &part : group) {
+        run.size += part.size;
+      }
+      MergeRuns(group, run.file, std::span(arena), less);
+      merged.push_back(std::move(run));
+    }
+    runs = std::move(merged);
+  }
+  MergeRuns(std::span(runs), output, std::span(arena), less);
+}
+#endif
+
+// A 64-byte record ordered by its key, for tests and benchmarks of payloads
+// that are expensive to move.
+struct WideRecord {
+  std::uint64_t key;
+  char payload[56];
+
+  friend bool operator==(const WideRecord &lhs, const WideRecord &rhs) {
+    return lhs.key == rhs.key;
+  }
+  friend auto operator<=>(const WideRecord &lhs, const WideRecord &rhs) {
+    return lhs.key <=> rhs.key;
+  }
+};
+
+// A fraction with a positive denominator, compared exactly by cross products,
+// for tests and benchmarks of comparators that cost more than a cached key.
+// Both parts convert to double exactly, so the rounded quotient is a key that
+// never contradicts the exact order.
+struct Fraction {
+  int num;
+  int den;
+
+  friend bool operator==(const Fraction &lhs, const Fraction &rhs) {
+    return (lhs <=> rhs) == 0;
+  }
+  friend std::strong_ordering operator<=>(const Fraction &lhs, const Fraction &rhs) {
+    return std::int64_t(lhs.num) * rhs.den <=> std::int64_t(rhs.num) * lhs.den;
+  }
+
+  double Approximation() const {
+    return static_cast<double>(num) / static_cast<double>(den);
+  }
+};
+
+std::vector<Fraction> RandomFractions(std::size_t size, int range, std::mt19937 &generator) {
+  std::vector<Fraction> fractions(size);
+  for (auto &fraction : fractions) {
+    fraction.num = static_cast<int>(generator() % (2 * range)) - range;
+    fraction.den = static_cast<int>(generator() % range) + 1;
+  }
+  return fractions;
+}
+
+void TestIntegers() {
+  std::size_t size = 1000;
+  std::vector<int> vector(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    vector[i] = static_cast<int>(size - i);
+  }
+  Sort(vector);
+  assert(std::ranges::is_sorted(vector));
+}
+
+void TestDoubles() {
+  std::vector<double> vector = {0.5, 0.1, 0.9, 0.3, 0.2};
+  Sort(vector);
+  assert(std::ranges::is_sorted(vector));
+}
+
+void TestStrings() {
+  std::vector<std::string> vector = {"banana", "apple", "cherry", "date"};
+  Sort(vector);
+  assert(std::ranges::is_sorted(vector));
+}
+
+void TestDuplicates() {
+  std::vector<int> vector = {5, 1, 5, 2, 5, 3, 5};
+  Sort(vector);
+  assert(std::ranges::is_sorted(vector));
+}
+
+void TestSorted() {
+  std::vector<int> vector = {1, 2, 3, 4, 5};
+  Sort(vector);
+  assert(std::ranges::is_sorted(vector));
+}
+
+void TestPatterns() {
+  std::size_t size = 100000;
+  std::vector<std::vector<int>> inputs;
+
+  std::vector<int> organPipe(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    organPipe[i] = static_cast<int>(std::min(i, size - i));
+  }
+  inputs.push_back(organPipe);
+
+  // Musser's median-of-3 killer sequence.
+  std::vector<int> killer(size);
+  auto half = size / 2;
+  for (std::size_t i = 1; i <= half; ++i) {
+    if (i % 2 == 1) {
+      killer[i - 1] = static_cast<int>(i);
+      killer[i] = static_cast<int>(half + i);
+    }
+    killer[half + i - 1] = static_cast<int>(2 * i);
+  }
+  inputs.push_back(killer);
+
+  std::vector<int> sawtooth(size);
+  std::vector<int> fewUnique(size);
+  std::vector<int> reversed(size);
+  std::mt19937 generator(7);
+  for (std::size_t i = 0; i < size; ++i) {
+    sawtooth[i] = static_cast<int>(i % 1000);
+    fewUnique[i] = static_cast<int>(generator() % 4);
+    reversed[i] = static_cast<int>(size - i);
+  }
+  inputs.push_back(sawtooth);
+  inputs.push_back(fewUnique);
+  inputs.push_back(reversed);
+
+  for (auto &input : inputs) {
+    auto expected = input;
+    std::ranges::sort(expected);
+    Sort(input);
+    assert(input == expected);
+  }
+}
+
+void TestMultikey() {
+  std::mt19937 generator(17);
+  std::vector<std::string> urls;
+  for (int i = 0; i < 3000; ++i) {
+    auto url = "https://example.com/catalog/" + std::to_string(generator() % 50) + "/item/";
+    url.append(generator() % 4, 'x');
+    url += std::to_string(generator() % 100);
+    urls.push_back(std::move(url));
+  }
+  urls.emplace_back();
+  urls.emplace_back();
+  urls.push_back(std::string("https://example.com\0a", 21));
+  urls.push_back(std::string("https://example.com\0", 20));
+  urls.push_back("https://example.com\xff");
+  urls.push_back("https://example.com");
+
+  auto expected = urls;
+  std::ranges::sort(expected);
+  Sort(urls);
+  assert(urls == expected);
+
+  std::vector<std::string> equal(200, std::string(1000, 'k'));
+  Sort(equal);
+  assert(std::ranges::all_of(equal, [](const auto &value) { return value.size() == 1000; }));
+
+  std::vector<std::size_t> order = {2, 0, 3, 1};
+  std::vector<std::string> letters = {"a", "b", "c", "d"};
+  ApplyPermutation(order, letters.begin());
+  assert((letters == std::vector<std::string>{"c", "a", "d", "b"}));
+}
+
+void TestSelect() {
+  std::mt19937 generator(21);
+  std::vector<std::vector<int>> inputs;
+  for (int range : {3, 1000, 1 << 30}) {
+    std::vector<int> input(5000);
+    for (auto &value : input) {
+      value = static_cast<int>(generator() % range);
+    }
+    inputs.push_back(input);
+  }
+  std::vector<int> ascending(3000);
+  std::iota(ascending.begin(), ascending.end(), 0);
+  inputs.push_back(ascending);
+  inputs.emplace_back(ascending.rbegin(), ascending.rend());
+
+  std::ranges::less less;
+  for (auto &input : inputs) {
+    auto expected = input;
+    std::ranges::sort(expected);
+    for (std::size_t k : {std::size_t(0), input.size() / 3, input.size() / 2, input.size() - 1}) {
+      auto vector = input;
+      assert(*Select(vector, k) == expected[k]);
+      auto below = [&](int x) { return x <= vector[k]; };
+      auto above = [&](int x) { return x >= vector[k]; };
+      assert(std::ranges::all_of(vector.begin(), vector.begin() + k, below));
+      assert(std::ranges::all_of(vector.begin() + k, vector.end(), above));
+
+      // No depth budget: every pivot comes from the median of medians.
+      vector = input;
+      SelectRange(vector.begin(), 0, vector.size(), k, 0, less);
+      assert(vector[k] == expected[k]);
+
+      vector = input;
+      PartialSort(vector, k);
+      assert(std::equal(vector.begin(), vector.begin() + k, expected.begin()));
+    }
+  }
+
+  std::vector<int> small = {4, 1, 3};
+  assert(Select(small, 3) == small.end());
+  std::vector<std::string> words = {"kiwi", "fig", "banana", "apple", "cherry"};
+  assert(*Select(words, 1, std::ranges::greater{}) == "fig");
+
+  TopK<int> top(100);
+  TopK<WideRecord, std::ranges::greater, std::uint64_t WideRecord::*> largest(3, {},
+                                                                             &WideRecord::key);
+  for (auto &input : inputs) {
+    top.Push(input);
+    for (auto value : input) {
+      largest.Push(WideRecord{static_cast<std::uint64_t>(value), {}});
+    }
+  }
+  std::vector<int> all;
+  for (auto &input : inputs) {
+    all.insert(all.end(), input.begin(), input.end());
+  }
+  std::ranges::sort(all);
+  assert(std::ranges::equal(top.Take(), all | std::views::take(100)));
+  auto keys = largest.Take();
+  assert(keys.size() == 3 && keys[0].key == static_cast<std::uint64_t>(all.back()));
+}
+
+void TestStableSort() {
+  std::mt19937 generator(23);
+  std::vector<std::pair<int, int>> pairs(20000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = {static_cast<int>(generator() % 100), static_cast<int>(i)};
+  }
+  auto expected = pairs;
+  std::ranges::stable_sort(expected, {}, &std::pair<int, int>::first);
+  StableSort(pairs, {}, &std::pair<int, int>::first);
+  assert(pairs == expected);
+
+  // Runs in both directions with ties inside the descending ones, which must
+  // not be reversed as a whole.
+  std::vector<std::pair<int, int>> runs;
+  for (int block = 0; block < 300; ++block) {
+    for (int i = 0; i < 50; ++i) {
+      auto key = block % 2 == 0 ? i : 50 - i / 2;
+      runs.emplace_back(key, static_cast<int>(runs.size()));
+    }
+  }
+  expected = runs;
+  std::ranges::stable_sort(expected, std::ranges::greater{}, &std::pair<int, int>::first);
+  StableSort(runs, std::ranges::greater{}, &std::pair<int, int>::first);
+  assert(runs == expected);
+
+  std::vector<int> scratch;
+  std::vector<int> appended(100000);
+  std::iota(appended.begin(), appended.end(), 0);
+  for (std::size_t i = appended.size() - 1000; i < appended.size(); ++i) {
+    appended[i] = static_cast<int>(generator() % appended.size());
+  }
+  auto sorted = appended;
+  std::ranges::sort(sorted);
+  for (int round = 0; round < 3; ++round) {
+    auto vector = appended;
+    StableSort(vector, scratch);
+    assert(vector == sorted);
+  }
+  auto *buffer = scratch.data();
+  auto vector = appended;
+  StableSort(vector, scratch);
+  assert(scratch.data() == buffer);
+
+  std::vector<std::string> words = {"pear", "fig", "banana", "kiwi", "apple", "plum"};
+  StableSort(words, std::ranges::less{}, &std::string::size);
+  assert((words == std::vector<std::string>{"fig", "pear", "kiwi", "plum", "apple", "banana"}));
+
+  std::vector<int> reversed(5000);
+  for (std::size_t i = 0; i < reversed.size(); ++i) {
+    reversed[i] = static_cast<int>(reversed.size() - i);
+  }
+  StableSort(reversed);
+  assert(std::ranges::is_sorted(reversed));
+}
+
+void TestSortByKey() {
+  std::mt19937 generator(29);
+  for (std::size_t size : {10, 5000}) {
+    std::vector<int> keys(size);
+    std::vector<std::string> names(size);
+    std::vector<double> weights(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      keys[i] = static_cast<int>(generator() % 50) - 25;
+      names[i] = "name" + std::to_string(i);
+      weights[i] = static_cast<double>(i);
+    }
+
+    auto order = ArgSort(keys);
+    std::vector<std::size_t> expected(size);
+    std::iota(expected.begin(), expected.end(), std::size_t(0));
+    std::ranges::stable_sort(expected, {}, [&](std::size_t i) { return keys[i]; });
+    assert(order == expected);
+
+    auto originalKeys = keys;
+    SortByKey(keys, names, weights);
+    assert(std::ranges::is_sorted(keys));
+    for (std::size_t i = 0; i < size; ++i) {
+      auto source = expected[i];
+      assert(keys[i] == originalKeys[source]);
+      assert(names[i] == "name" + std::to_string(source));
+      assert(weights[i] == static_cast<double>(source));
+    }
+  }
+
+  std::vector<double> doubles = {2.5, -1.0, 2.5, 0.0, -7.25};
+  assert((ArgSort(doubles) == std::vector<std::size_t>{4, 1, 3, 0, 2}));
+
+  // Signed zeros compare equal, so the radix path keeps them in input order.
+  std::vector<double> zeros(2 * RADIX_THRESHOLD);
+  for (std::size_t i = 0; i < zeros.size(); ++i) {
+    zeros[i] = generator() % 2 == 0 ? -0.0 : 0.0;
+  }
+  zeros[7] = -1.0;
+  auto zeroOrder = ArgSort(zeros);
+  assert(zeroOrder[0] == 7);
+  for (std::size_t i = 1; i < zeros.size(); ++i) {
+    assert(zeroOrder[i] == (i <= 7 ? i - 1 : i));
+  }
+  std::vector<std::string> words = {"pear", "fig", "banana"};
+  assert((ArgSort(words, std::ranges::greater{}) == std::vector<std::size_t>{0, 1, 2}));
+  assert((ArgSort(words, {}, &std::string::size) == std::vector<std::size_t>{1, 0, 2}));
+}
+
+void TestSortCached() {
+  std::mt19937 generator(37);
+  for (std::size_t size : {0, 1, 100, 5000}) {
+    // A small range makes equal fractions such as 1/2 and 2/4 common.
+    auto fractions = RandomFractions(size, 12, generator);
+    auto expected = fractions;
+    std::ranges::sort(expected);
+    SortCached(fractions, &Fraction::Approximation);
+    assert(fractions == expected);
+  }
+
+  // Near-equal fractions whose keys tie are ordered by the comparator.
+  const int big = 1 << 30;
+  std::vector<Fraction> close = {{big, big - 1}, {big - 1, big - 2}, {1, 1}, {big + 1, big}};
+  SortCached(close, &Fraction::Approximation);
+  assert(std::ranges::is_sorted(close));
+
+  std::vector<std::string> words = {"pear", "peach", "fig", "plum", "banana", "apple"};
+  SortCached(words, [](const std::string &word) { return word.empty() ? 0 : -word[0]; },
+             std::ranges::greater{});
+  assert(std::ranges::is_sorted(words, std::ranges::greater{}));
+
+  auto fractions = RandomFractions(1000, 100, generator);
+  SortCached(fractions, std::negate<>{}, std::ranges::greater{}, &Fraction::num);
+  assert(std::ranges::is_sorted(fractions, std::ranges::greater{}, &Fraction::num));
+
+  // Move-only elements are only ever moved, once, after the keys are sorted.
+  std::vector<std::unique_ptr<int>> pointers;
+  for (int i = 0; i < 3000; ++i) {
+    pointers.push_back(std::make_unique<int>(static_cast<int>(generator() % 1000)));
+  }
+  SortCached(pointers, [](int value) { return value / 10; }, {},
+             [](const std::unique_ptr<int> &pointer) { return *pointer; });
+  assert(std::ranges::is_sorted(pointers, {}, [](const auto &pointer) { return *pointer; }));
+}
+
+void TestSortedVector() {
+  std::mt19937 generator(31);
+  SortedVector<int> sorted(64);
+  std::multiset<int> expected;
+  for (int burst = 0; burst < 40; ++burst) {
+    std::vector<int> values(1 + generator() % 500);
+    for (auto &value : values) {
+      value = static_cast<int>(generator() % 10000);
+    }
+    sorted.Insert(values);
+    expected.insert(values.begin(), values.end());
+
+    auto probe = static_cast<int>(generator() % 10000);
+    auto *found = sorted.LowerBound(probe);
+    auto it = expected.lower_bound(probe);
+    assert(it == expected.end() ? found == nullptr : found != nullptr && *found == *it);
+    assert(sorted.Contains(probe) == expected.contains(probe));
+
+    auto lo = static_cast<int>(generator() % 10000);
+    auto hi = lo + static_cast<int>(generator() % 500);
+    auto range = sorted.Range(lo, hi);
+    assert(std::ranges::equal(range, std::ranges::subrange(expected.lower_bound(lo),
+                                                           expected.lower_bound(hi))));
+    assert(sorted.Count(lo, hi) == range.size());
+  }
+  assert(sorted.Size() == expected.size());
+  assert(sorted.Levels() > 1);
+  assert(std::ranges::equal(sorted.Compact(), expected));
+  assert(sorted.Levels() == 1);
+
+  SortedVector<std::string, std::ranges::greater> words(2);
+  words.Insert(std::vector<std::string>{"fig", "apple", "pear"});
+  assert(*words.LowerBound("banana") == "apple");
+  assert((words.Range("pear", "b") == std::vector<std::string>{"pear", "fig"}));
+}
+
+void TestHeapSort() {
+  std::vector<int> vector = {9, 4, 7, 1, 8, 2, 2, 6, 3, 5};
+  std::ranges::less less;
+  HeapSort(vector.begin(), 2, 8, less);
+  assert((vector == std::vector<int>{9, 4, 1, 2, 2, 6, 7, 8, 3, 5}));
+}
+
+template <typename Partitioner>
+void CheckPartition(std::vector<int> vector, Partitioner partitioner) {
+  std::ranges::less less;
+  ChoosePivot(vector.begin(), 0, vector.size(), less);
+  auto pivot = vector[0];
+  auto [pivotIndex, alreadyPartitioned] = partitioner(vector.begin(), 0, vector.size(), less);
+  assert(vector[pivotIndex] == pivot);
+  for (std::size_t i = 0; i < vector.size(); ++i) {
+    assert(i < pivotIndex ? vector[i] < pivot : vector[i] >= pivot);
+  }
+  (void)alreadyPartitioned;
+}
+
+void TestPartitions() {
+  std::mt19937 generator(9);
+  for (std::size_t size : {3, 17, 64, 129, 1000, 5000}) {
+    for (int range : {2, 100, 1 << 30}) {
+      std::vector<int> vector(size);
+      for (auto &value : vector) {
+        value = static_cast<int>(generator() % range);
+      }
+      CheckPartition(vector, [](auto... args) { return PartitionHoare(args...); });
+      CheckPartition(vector, [](auto... args) { return PartitionBlock(args...); });
+      std::ranges::sort(vector, std::ranges::greater{});
+      CheckPartition(vector, [](auto... args) { return PartitionBlock(args...); });
+    }
+  }
+}
+
+void TestRadix() {
+  std::mt19937_64 generator(3);
+
+  std::vector<int> integers(5000);
+  for (auto &value : integers) {
+    value = static_cast<int>(generator());
+  }
+  auto expectedIntegers = integers;
+  std::ranges::sort(expectedIntegers);
+  Sort(integers);
+  assert(integers == expectedIntegers);
+
+  // Only the lowest byte varies, so three of the four passes are skipped.
+  std::vector<std::uint32_t> narrow(5000);
+  for (auto &value : narrow) {
+    value = 0x12345600u + static_cast<std::uint32_t>(generator() % 256);
+  }
+  Sort(narrow);
+  assert(std::ranges::is_sorted(narrow));
+
+  std::vector<double> doubles = {
+      0.0, -0.0, 1.5, -1.5, std::numeric_limits<double>::infinity(),
+      -std::numeric_limits<double>::infinity(),
+      std::numeric_limits<double>::denorm_min(),
+      -std::numeric_limits<double>::denorm_min(),
+      std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max()};
+  while (doubles.size() < 4000) {
+    doubles.push_back(std::bit_cast<double>(generator() >> 2) *
+                      (generator() % 2 == 0 ? 1 : -1));
+  }
+  Sort(doubles);
+  assert(std::ranges::is_sorted(doubles));
+  auto zero = std::ranges::find(doubles, 0.0);
+  assert(std::signbit(*zero) && !std::signbit(*(zero + 1)));
+
+  std::vector<float> floats(1000);
+  for (auto &value : floats) {
+    value = static_cast<float>(static_cast<int>(generator() % 2001) - 1000) / 7.0f;
+  }
+  Sort(floats);
+  assert(std::ranges::is_sorted(floats));
+
+  std::vector<std::int8_t> bytes(1000);
+  for (auto &value : bytes) {
+    value = static_cast<std::int8_t>(generator());
+  }
+  Sort(bytes);
+  assert(std::ranges::is_sorted(bytes));
+}
+
+template <NetworkKey T> void CheckNetworkKernel(NetworkKernel<T> kernel) {
+  std::mt19937_64 generator(11);
+  for (int round = 0; round < 200; ++round) {
+    std::array<T, NETWORK_SIZE> keys;
+    for (auto &key : keys) {
+      key = static_cast<T>(static_cast<std::int64_t>(generator() % 41) - 20);
+    }
+    auto expected = keys;
+    std::ranges::sort(expected);
+    kernel(keys.data());
+    assert(keys == expected);
+  }
+}
+
+template <NetworkKey T> void CheckNetworkKernels() {
+  CheckNetworkKernel<T>(SortNetworkScalar<T>);
+#if defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    CheckNetworkKernel<T>(SortNetworkSse4<T>);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    CheckNetworkKernel<T>(SortNetworkAvx2<T>);
+  }
+#endif
+}
+
+void TestNetwork() {
+  CheckNetworkKernels<std::int32_t>();
+  CheckNetworkKernels<std::int64_t>();
+  CheckNetworkKernels<float>();
+  CheckNetworkKernels<double>();
+
+  std::ranges::less less;
+  for (std::size_t size = 0; size <= NETWORK_SIZE; ++size) {
+    std::vector<int> vector(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      vector[i] = static_cast<int>((i * 7919) % 13) - 6;
+    }
+    SortLeaf(vector.begin(), 0, size, less);
+    assert(std::ranges::is_sorted(vector));
+  }
+
+  // Equal keys with different bits must both survive the network.
+  std::vector<double> zeros = {0.0, -0.0, 1.0, -0.0, 0.0, -1.0};
+  SortLeaf(zeros.begin(), 0, zeros.size(), less);
+  assert(std::ranges::count_if(zeros, [](double x) { return x == 0.0 && std::signbit(x); }) == 2);
+  assert(std::ranges::count_if(zeros, [](double x) { return x == 0.0 && !std::signbit(x); }) == 2);
+}
+
+struct Record {
+  static inline std::size_t copies = 0;
+
+  Record(int id, std::string name) : id(id), name(std::move(name)) {}
+  Record(const Record &other) : id(other.id), name(other.name) { ++copies; }
+  Record(Record &&) = default;
+  Record &operator=(const Record &other) {
+    id = other.id;
+    name = other.name;
+    ++copies;
+    return *this;
+  }
+  Record &operator=(Record &&) = default;
+
+  int id;
+  std::string name;
+};
+
+void TestRanges() {
+  std::deque<int> deque;
+  for (int i = 0; i < 500; ++i) {
+    deque.push_back((i * 37) % 101);
+  }
+  Sort(deque);
+  assert(std::ranges::is_sorted(deque));
+
+  int array[] = {5, -3, 9, 0, 2, 2, -7};
+  Sort(array);
+  assert(std::ranges::is_sorted(array));
+
+  std::vector<int> vector = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  Sort(std::span(vector).subspan(2, 5));
+  assert((vector == std::vector<int>{9, 8, 3, 4, 5, 6, 7, 2, 1, 0}));
+
+  Sort(std::views::reverse(vector));
+  assert(std::ranges::is_sorted(vector, std::ranges::greater{}));
+
+  std::vector<std::string> words = {"pear", "fig", "banana", "kiwi", "apple"};
+  Sort(words, std::ranges::less{}, &std::string::size);
+  assert(std::ranges::is_sorted(words, {}, &std::string::size));
+}
+
+void TestProjections() {
+  std::vector<Record> records;
+  for (int i = 0; i < 300; ++i) {
+    records.emplace_back((i * 71) % 300, "record" + std::to_string(i));
+  }
+  Record::copies = 0;
+  Sort(records, std::ranges::greater{}, &Record::id);
+  assert(Record::copies == 0);
+  assert(std::ranges::is_sorted(records, std::ranges::greater{}, &Record::id));
+
+  std::vector<std::unique_ptr<int>> pointers;
+  for (int i = 0; i < 200; ++i) {
+    pointers.push_back(std::make_unique<int>((i * 13) % 200));
+  }
+  auto dereference = [](const std::unique_ptr<int> &pointer) { return *pointer; };
+  Sort(pointers, std::ranges::less{}, dereference);
+  assert(std::ranges::is_sorted(pointers, {}, dereference));
+
+  std::vector<int> large(4 * PARALLEL_THRESHOLD);
+  std::mt19937 generator(5);
+  for (auto &value : large) {
+    value = static_cast<int>(generator() % 5000);
+  }
+  Sort(large, 4, std::ranges::greater{});
+  assert(std::ranges::is_sorted(large, std::ranges::greater{}));
+}
+
+void TestParallel() {
+  std::size_t size = 3 * PARALLEL_PARTITION_THRESHOLD / 2;
+  std::mt19937 generator(42);
+  std::vector<int> vector(size);
+  for (auto &value : vector) {
+    value = static_cast<int>(generator() % 1000);
+  }
+  auto expected = vector;
+  std::ranges::sort(expected);
+
+  auto first = vector;
+  Sort(first, 4);
+  assert(first == expected);
+
+  auto second = vector;
+  Sort(second, 3);
+  assert(second == expected);
+
+  std::vector<int> equal(size, 7);
+  Sort(equal, 4);
+  assert(std::ranges::is_sorted(equal));
+}
+
+#ifdef __linux__
+
+template <typename T>
+std::vector<T> RoundTripExternal(const std::vector<T> &input, std::size_t memoryBudget,
+                                 auto... order) {
+  auto directory = std::filesystem::temp_directory_path();
+  auto inputPath = (directory / ("external-input-" + std::to_string(getpid()))).string();
+  auto outputPath = (directory / ("external-output-" + std::to_string(getpid()))).string();
+  {
+    auto file = FileHandle::Open(inputPath, O_WRONLY | O_CREAT | O_TRUNC);
+    file.Write(input.data(), input.size() * sizeof(T), 0);
+  }
+  ExternalSortOptions options;
+  options.memoryBudget = memoryBudget;
+  ExternalSort<T>(inputPath, outputPath, options, order...);
+
+  auto file = FileHandle::Open(outputPath, O_RDONLY);
+  std::vector<T> output(file.Size() / sizeof(T));
+  file.Read(output.data(), output.size() * sizeof(T), 0);
+  std::filesystem::remove(inputPath);
+  std::filesystem::remove(outputPath);
+  return output;
+}
+
+void TestExternal() {
+  std::mt19937 generator(13);
+  std::vector<int> integers(100000);
+  for (auto &value : integers) {
+    value = static_cast<int>(generator());
+  }
+  auto expected = integers;
+  std::ranges::sort(expected);
+  // 16K records of budget: 25 runs merged two at a time over several passes.
+  assert(RoundTripExternal(integers, 1 << 16) == expected);
+  // Everything fits into one chunk and never touches a temporary file.
+  assert(RoundTripExternal(integers, 1 << 22) == expected);
+  assert(RoundTripExternal(std::vector<int>{}, 1 << 16).empty());
+
+  std::vector<WideRecord> records(5000);
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    records[i].key = generator() % 1000;
+    records[i].payload[0] = static_cast<char>(i);
+  }
+  auto sorted = RoundTripExternal(records, 1 << 14, std::ranges::greater{}, &WideRecord::key);
+  assert(sorted.size() == records.size());
+  assert(std::ranges::is_sorted(sorted, std::ranges::greater{}, &WideRecord::key));
+
+  // Sorting a file onto itself is refused before the output truncates it,
+  // also when the output names it through a hard link.
+  auto directory = std::filesystem::temp_directory_path();
+  auto path = (directory / ("external-self-" + std::to_string(getpid()))).string();
+  auto link = path + "-link";
+  {
+    auto file = FileHandle::Open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    file.Write(integers.data(), integers.size() * sizeof(int), 0);
+  }
+  std::filesystem::create_hard_link(path, link);
+  for (const auto &output : {path, link}) {
+    bool thrown = false;
+    try {
+      ExternalSort<int>(path, output);
+    } catch (const std::invalid_argument &) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  assert(FileHandle::Open(path, O_RDONLY).Size() == integers.size() * sizeof(int));
+  std::filesystem::remove(link);
+  std::filesystem::remove(path);
+}
+#endif
+
+void BenchmarkParallel(std::size_t size) {
+  std::mt19937 generator(42);
+  std::vector<int> input(size);
+  for (auto &value : input) {
+    value = static_cast<int>(generator());
+  }
+
+  auto maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  double baseline = 0;
+  std::cout << "threads,seconds,speedup\n";
+  for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    auto vector = input;
+    auto start = std::chrono::steady_clock::now();
+    Sort(vector, threads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    assert(std::ranges::is_sorted(vector));
+    if (threads == 1) {
+      baseline = elapsed.count();
+    }
+    std::cout << threads << ',' << elapsed.count() << ','
+              << baseline / elapsed.count() << '\n';
+  }
+}
+
+template <typename Leaf>
+double MeasureLeaves(const std::vector<std::vector<int>> &leaves, Leaf leaf) {
+  auto copies = leaves;
+  auto start = std::chrono::steady_clock::now();
+  for (auto &copy : copies) {
+    leaf(copy);
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(copies.size());
+}
+
+// Fractions sorted by the exact comparator against SortCached with their
+// double approximation as the key.
+void BenchmarkCached(std::size_t size) {
+  std::mt19937 generator(42);
+  auto input = RandomFractions(size, 1 << 20, generator);
+  auto measure = [&](auto sort) {
+    auto fractions = input;
+    auto start = std::chrono::steady_clock::now();
+    sort(fractions);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    assert(std::ranges::is_sorted(fractions));
+    return elapsed.count();
+  };
+  std::cout << "method,seconds\n";
+  std::cout << "sort," << measure([](auto &fractions) { Sort(fractions); }) << '\n';
+  std::cout << "sort_cached," << measure([](auto &fractions) {
+    SortCached(fractions, &Fraction::Approximation);
+  }) << '\n';
+}
+
+// Time per leaf of random size up to NETWORK_SIZE for every leaf kernel.
+void BenchmarkLeaf(std::size_t count) {
+  std::mt19937 generator(42);
+  std::vector<std::vector<int>> leaves(count);
+  for (auto &leaf : leaves) {
+    leaf.resize(2 + generator() % (NETWORK_SIZE - 1));
+    for (auto &value : leaf) {
+      value = static_cast<int>(generator());
+    }
+  }
+
+  auto network = [&](NetworkKernel<int> kernel) {
+    return [kernel](std::vector<int> &leaf) {
+      std::array<int, NETWORK_SIZE> keys;
+      keys.fill(std::numeric_limits<int>::max());
+      std::ranges::copy(leaf, keys.begin());
+      kernel(keys.data());
+      std::copy(keys.begin(), keys.begin() + leaf.size(), leaf.begin());
+    };
+  };
+
+  std::cout << "kernel,ns_per_leaf\n";
+  std::cout << "insertion," << MeasureLeaves(leaves, [](std::vector<int> &leaf) {
+    std::ranges::less less;
+    Order(leaf.begin(), 0, leaf.size(), less);
+  }) << '\n';
+  std::cout << "scalar_network," << MeasureLeaves(leaves, network(SortNetworkScalar<int>)) << '\n';
+#if defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    std::cout << "sse4_network," << MeasureLeaves(leaves, network(SortNetworkSse4<int>)) << '\n';
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    std::cout << "avx2_network," << MeasureLeaves(leaves, network(SortNetworkAvx2<int>)) << '\n';
+  }
+#endif
+}
+
+// Counts branch misses of the calling thread through perf_event_open. Where
+// that is unavailable (other systems, containers without perf access) the
+// counter reports -1.
+class BranchMissCounter {
+public:
+  BranchMissCounter() {
+#ifdef __linux__
+    perf_event_attr attributes{};
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    descriptor_ = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+  }
+
+  BranchMissCounter(const BranchMissCounter &) = delete;
+  BranchMissCounter &operator=(const BranchMissCounter &) = delete;
+
+  ~BranchMissCounter() {
+#ifdef __linux__
+    if (descriptor_ >= 0) {
+      close(descriptor_);
+    }
+#endif
+  }
+
+  void Start() {
+#ifdef __linux__
+    if (descriptor_ >= 0) {
+      ioctl(descriptor_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(descriptor_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  long long Stop() {
+    long long count = -1;
+#ifdef __linux__
+    if (descriptor_ >= 0) {
+      ioctl(descriptor_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(descriptor_, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int descriptor_ = -1;
+};
+
+// Partitions random inputs once with each scheme and reports throughput and
+// branch misses per element.
+template <typename T, typename Make>
+void BenchmarkPartitionType(const char *type, std::size_t size, Make make) {
+  std::mt19937_64 generator(42);
+  std::vector<T> input(size);
+  for (auto &value : input) {
+    value = make(generator);
+  }
+
+  auto measure = [&](const char *scheme, auto partitioner) {
+    const std::size_t rounds = 10;
+    std::ranges::less less;
+    BranchMissCounter counter;
+    std::chrono::duration<double, std::nano> elapsed{};
+    long long misses = 0;
+    for (std::size_t round = 0; round < rounds; ++round) {
+      auto vector = input;
+      ChoosePivot(vector.begin(), 0, vector.size(), less);
+      counter.Start();
+      auto start = std::chrono::steady_clock::now();
+      partitioner(vector.begin(), 0, vector.size(), less);
+      elapsed += std::chrono::steady_clock::now() - start;
+      auto count = counter.Stop();
+      misses = count < 0 || misses < 0 ? -1 : misses + count;
+    }
+    auto elements = static_cast<double>(rounds * size);
+    std::cout << type << ',' << scheme << ',' << elapsed.count() / elements << ','
+              << (misses < 0 ? -1.0 : static_cast<double>(misses) / elements) << '\n';
+  };
+
+  measure("hoare", [](auto... args) { return PartitionHoare(args...); });
+  measure("block", [](auto... args) { return PartitionBlock(args...); });
+}
+
+void BenchmarkPartition(std::size_t size) {
+  std::cout << "type,scheme,ns_per_element,branch_misses_per_element\n";
+  BenchmarkPartitionType<int>("int", size, [](auto &generator) {
+    return static_cast<int>(generator());
+  });
+  BenchmarkPartitionType<double>("double", size, [](auto &generator) {
+    return static_cast<double>(generator()) / 3.0;
+  });
+  BenchmarkPartitionType<std::string>("string", size / 4, [](auto &generator) {
+    return "key" + std::to_string(generator());
+  });
+}
+
+struct BenchmarkResult {
+  std::string algorithm;
+  std::string type;
+  std::string distribution;
+  std::size_t size = 0;
+  double nsPerElement = 0;
+
+  std::string Key() const {
+    return algorithm + ' ' + type + ' ' + distribution + ' ' + std::to_string(size);
+  }
+};
+
+const std::array<const char *, 7> BENCHMARK_DISTRIBUTIONS = {
+    "random", "sorted", "appended", "reversed", "organ_pipe", "few_unique", "sawtooth"};
+
+// Ranks in the shape of the distribution; BenchmarkKey turns them into keys
+// of each type without changing their order.
+std::vector<std::uint64_t> MakeDistribution(std::string_view name, std::size_t size,
+                                            std::mt19937_64 &generator) {
+  std::vector<std::uint64_t> ranks(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    if (name == "random") {
+      ranks[i] = generator() >> 32;
+    } else if (name == "sorted") {
+      ranks[i] = i;
+    } else if (name == "appended") {
+      // A sorted log with a 1% batch of new entries appended at the end.
+      ranks[i] = i < size - size / 100 ? i : generator() % size;
+    } else if (name == "reversed") {
+      ranks[i] = size - i;
+    } else if (name == "organ_pipe") {
+      ranks[i] = std::min(i, size - i);
+    } else if (name == "few_unique") {
+      ranks[i] = generator() % 16;
+    } else {
+      ranks[i] = i % std::max<std::size_t>(std::bit_floor(size) >> 4, 2);
+    }
+  }
+  return ranks;
+}
+
+template <typename T> T BenchmarkKey(std::uint64_t rank) {
+  if constexpr (std::same_as<T, std::string>) {
+    // Keys share a long prefix and are zero-padded, so their lexicographic
+    // order is the order of the ranks.
+    auto digits = std::to_string(rank);
+    return "tenant/0042/events/2024/" + std::string(20 - digits.size(), '0') + digits;
+  } else if constexpr (std::same_as<T, WideRecord>) {
+    WideRecord record{};
+    record.key = rank;
+    return record;
+  } else {
+    return static_cast<T>(rank);
+  }
+}
+
+// Times every algorithm on every distribution for sizes 10, 100, ... up to
+// maxSize. Small inputs are sorted as a batch of copies totalling about
+// BENCHMARK_ELEMENTS elements so the clock is read once per batch, and the
+// fastest of BENCHMARK_ROUNDS rounds is reported.
+template <typename T>
+void BenchmarkSuiteType(const char *type, std::size_t maxSize,
+                        std::vector<BenchmarkResult> &results) {
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::pair<const char *, std::function<void(std::vector<T> &)>>> algorithms = {
+      {"Sort", [](std::vector<T> &vector) { Sort(vector); }},
+      {"Sort_parallel", [threads](std::vector<T> &vector) { Sort(vector, threads); }},
+      {"StableSort", [](std::vector<T> &vector) { StableSort(vector); }},
+      {"std::sort", [](std::vector<T> &vector) { std::sort(vector.begin(), vector.end()); }},
+      {"std::stable_sort",
+       [](std::vector<T> &vector) { std::stable_sort(vector.begin(), vector.end()); }},
+  };
+
+  std::mt19937_64 generator(42);
+  for (std::size_t size = 10; size <= maxSize; size *= 10) {
+    auto batch = std::max<std::size_t>(BENCHMARK_ELEMENTS / size, 1);
+    for (auto distribution : BENCHMARK_DISTRIBUTIONS) {
+      std::vector<T> input;
+      input.reserve(size);
+      for (auto rank : MakeDistribution(distribution, size, generator)) {
+        input.push_back(BenchmarkKey<T>(rank));
+      }
+
+      for (auto &[algorithm, run] : algorithms) {
+        std::chrono::duration<double, std::nano> best = std::chrono::hours(1);
+        for (std::size_t round = 0; round < BENCHMARK_ROUNDS; ++round) {
+          std::vector<std::vector<T>> copies(batch, input);
+          auto start = std::chrono::steady_clock::now();
+          for (auto &copy : copies) {
+            run(copy);
+          }
+          best = std::min<std::chrono::duration<double, std::nano>>(
+              best, std::chrono::steady_clock::now() - start);
+          assert(std::ranges::is_sorted(copies.front()));
+        }
+
+        BenchmarkResult result{algorithm, type, distribution, size,
+                               best.count() / static_cast<double>(batch * size)};
+        std::cout << result.algorithm << ',' << result.type << ',' << result.distribution
+                  << ',' << result.size << ',' << result.nsPerElement << '\n';
+        results.push_back(std::move(result));
+      }
+    }
+  }
+}
+
+// Writes one result object per line so a baseline can be read back without a
+// JSON library.
+void WriteBenchmarkJson(const std::string &path, const std::vector<BenchmarkResult> &results) {
+  std::ofstream stream(path);
+  stream << "[\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto &result = results[i];
+    stream << "  {\"algorithm\": \"" << result.algorithm << "\", \"type\": \"" << result.type
+           << "\", \"distribution\": \"" << result.distribution << "\", \"size\": " << result.size
+           << ", \"ns_per_element\": " << result.nsPerElement << '}'
+           << (i + 1 < results.size() ? "," : "") << '\n';
+  }
+  stream << "]\n";
+}
+
+std::string JsonField(std::string_view line, std::string_view name) {
+  auto key = "\"" + std::string(name) + "\": ";
+  auto start = line.find(key);
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  start += key.size();
+  if (line[start] == '"') {
+    ++start;
+    return std::string(line.substr(start, line.find('"', start) - start));
+  }
+  return std::string(line.substr(start, line.find_first_of(",}", start) - start));
+}
+
+std::vector<BenchmarkResult> ReadBenchmarkJson(const std::string &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw std::runtime_error("cannot read baseline " + path);
+  }
+  std::vector<BenchmarkResult> results;
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.find("\"algorithm\"") == std::string::npos) {
+      continue;
+    }
+    results.push_back({JsonField(line, "algorithm"), JsonField(line, "type"),
+                       JsonField(line, "distribution"), std::stoul(JsonField(line, "size")),
+                       std::stod(JsonField(line, "ns_per_element"))});
+  }
+  return results;
+}
+
+// Reports every measurement that got slower than its baseline by more than
+// BENCHMARK_TOLERANCE and returns how many did.
+std::size_t CompareBenchmarks(const std::vector<BenchmarkResult> &results,
+                              const std::vector<BenchmarkResult> &baseline) {
+  std::map<std::string, double> previous;
+  for (auto &result : baseline) {
+    previous[result.Key()] = result.nsPerElement;
+  }
+  std::size_t regressions = 0;
+  for (auto &result : results) {
+    auto found = previous.find(result.Key());
+    if (found == previous.end()) {
+      continue;
+    }
+    auto ratio = result.nsPerElement / found->second;
+    if (ratio > 1 + BENCHMARK_TOLERANCE) {
+      std::cerr << "regression: " << result.Key() << ' ' << found->second << " -> "
+                << result.nsPerElement << " ns/element (x" << ratio << ")\n";
+      ++regressions;
+    }
+  }
+  return regressions;
+}
+
+// '--bench suite [maxSize] [--json path] [--baseline path]'. Exits with 1 when
+// the comparison against the baseline found regressions.
+int BenchmarkSuite(std::span<char *const> arguments) {
+  std::size_t maxSize = 1000000;
+  std::string jsonPath;
+  std::string baselinePath;
+  for (std::size_t i = 0; i < arguments.size(); ++i) {
+    std::string_view argument = arguments[i];
+    if (argument == "--json" && i + 1 < arguments.size()) {
+      jsonPath = arguments[++i];
+    } else if (argument == "--baseline" && i + 1 < arguments.size()) {
+      baselinePath = arguments[++i];
+    } else {
+      maxSize = std::stoul(std::string(argument));
+    }
+  }
+
+  std::vector<BenchmarkResult> results;
+  std::cout << "algorithm,type,distribution,size,ns_per_element\n";
+  BenchmarkSuiteType<int>("int", maxSize, results);
+  BenchmarkSuiteType<double>("double", maxSize, results);
+  BenchmarkSuiteType<std::string>("string", maxSize, results);
+  BenchmarkSuiteType<WideRecord>("record64", maxSize, results);
+
+  if (!jsonPath.empty()) {
+    WriteBenchmarkJson(jsonPath, results);
+  }
+  if (!baselinePath.empty() && CompareBenchmarks(results, ReadBenchmarkJson(baselinePath)) > 0) {
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2 && std::string_view(argv[1]) == "--bench") {
+    std::string_view name = argv[2];
+    if (name == "parallel") {
+      BenchmarkParallel(argc > 3 ? std::stoul(argv[3]) : 1 << 24);
+    } else if (name == "leaf") {
+      BenchmarkLeaf(argc > 3 ? std::stoul(argv[3]) : 1 << 20);
+    } else if (name == "partition") {
+      BenchmarkPartition(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    } else if (name == "cached") {
+      BenchmarkCached(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    } else if (name == "suite") {
+      return BenchmarkSuite(std::span(argv + 3, argv + argc));
+    }
+    return 0;
+  }
+
   TestIntegers();
   TestDoubles();
   TestStrings();
   TestDuplicates();
   TestSorted();
+  TestPatterns();
+  TestHeapSort();
+  TestPartitions();
+  TestRadix();
+  TestMultikey();
+  TestSelect();
+  TestStableSort();
+  TestSortByKey();
+  TestSortCached();
+  TestSortedVector();
+  TestNetwork();
+  TestRanges();
+  TestProjections();
+  TestParallel();
+#ifdef __linux__
+  TestExternal();
+#endif
   return 0;
 }
\ No newline at end of file
@@ -1,119 +1,1984 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cctype>
+#include <chrono>
 #include <cmath>
 #include <compare>
 #include <concepts>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <random>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 const double EPSILON_VAL = 1e-6;
+// Relative gap above which two double approximations of rationals decide
+// their order; far above the rounding error of the conversions.
+const double APPROXIMATION_TOLERANCE = 1e-9;
+const std::size_t BENCHMARK_VALUES = 1 << 12;
+const int BENCHMARK_RANGE = 1 << 10;
+// Odd constants from splitmix64 that decorrelate the numerator and the
+// denominator before they are multiplied together in a hash.
+const std::uint64_t HASH_SEEDS[2] = {0x9e3779b97f4a7c15, 0xbf58476d1ce4e5b9};
+// Smallest table of FlatHashMap; it holds up to seven eighths of its slots.
+const std::size_t FLAT_HASH_MIN_SLOTS = 16;
+// Columns per tile of the RationalMatrix row updates, and the number of
+// entries an elimination step must update before it is split among threads.
+const std::size_t MATRIX_BLOCK = 64;
+const std::size_t MATRIX_PARALLEL_ENTRIES = 1 << 12;
+// The multi-modular engine works modulo primes below MODULAR_PRIME_LIMIT.
+// Between two reconstructions it adds MULTIMODULAR_BATCH of them or a
+// quarter of those used so far, whichever is more, and it gives up after
+// MULTIMODULAR_MAX_PRIMES, about 250000 bits of result.
+const std::uint64_t MODULAR_PRIME_LIMIT = std::uint64_t(1) << 62;
+const std::size_t MULTIMODULAR_BATCH = 4;
+const std::size_t MULTIMODULAR_MAX_PRIMES = 1 << 12;
+// Lazy BigInt arithmetic reduces once a denominator would grow past this many
+// bits, since nothing overflows to make it reduce on its own.
+const std::size_t LAZY_REDUCE_BITS = 1024;
 
-template <typename T> class Rational {
+__extension__ using Int128 = __int128;
+__extension__ using UInt128 = unsigned __int128;
+
+// Binary GCD for the built-in integer types: one countr_zero strips the
+// common power of two and the loop only shifts and subtracts, which is much
+// cheaper than the divisions of Euclid's algorithm. BigInt brings its own
+// overload, and Rational<T> calls Gcd unqualified so that either is found.
+template <std::integral T> T Gcd(T a, T b) {
+  using Unsigned = std::make_unsigned_t<T>;
+  auto x = static_cast<Unsigned>(a);
+  auto y = static_cast<Unsigned>(b);
+  if constexpr (std::signed_integral<T>) {
+    x = a < 0 ? Unsigned(0) - x : x;
+    y = b < 0 ? Unsigned(0) - y : y;
+  }
+  if (x == 0 || y == 0) {
+    return static_cast<T>(x | y);
+  }
+  auto shift = std::countr_zero(Unsigned(x | y));
+  x >>= std::countr_zero(x);
+  do {
+    y >>= std::countr_zero(y);
+    auto low = std::min(x, y);
+    y = std::max(x, y) - low;
+    x = low;
+  } while (y != 0);
+  return static_cast<T>(x << shift);
+}
+
+// Arbitrary-precision signed integer. Values that fit in std::int64_t are
+// stored inline and every operation on two of them is a single checked
+// machine instruction; only a result that overflows is promoted to a
+// magnitude of 64-bit limbs on the heap (least significant first) with a
+// separate sign. Results that fit again are demoted, so the representation
+// of every value is unique.
+class BigInt {
+public:
+  using Limbs = std::vector<std::uint64_t>;
+
+  BigInt(long long value = 0) : small_(value) {}
+
+  // Parses an optional sign followed by decimal digits; throws
+  // std::invalid_argument on anything else.
+  explicit BigInt(std::string_view digits) {
+    bool negative = !digits.empty() && digits.front() == '-';
+    if (!digits.empty() && (digits.front() == '-' || digits.front() == '+')) {
+      digits.remove_prefix(1);
+    }
+    if (digits.empty() ||
+        !std::ranges::all_of(digits, [](char c) { return c >= '0' && c <= '9'; })) {
+      throw std::invalid_argument("BigInt: not a decimal integer");
+    }
+    Limbs magnitude;
+    while (!digits.empty()) {
+      auto chunk = digits.size() % DECIMAL_CHUNK_DIGITS;
+      chunk = chunk == 0 ? DECIMAL_CHUNK_DIGITS : chunk;
+      std::uint64_t value = 0;
+      std::uint64_t scale = 1;
+      for (std::size_t i = 0; i < chunk; ++i) {
+        value = value * 10 + static_cast<std::uint64_t>(digits[i] - '0');
+        scale *= 10;
+      }
+      MultiplyAdd(magnitude, scale, value);
+      digits.remove_prefix(chunk);
+    }
+    *this = FromMagnitude(std::move(magnitude), negative);
+  }
+
+  // Whether the value is held inline, without heap limbs.
+  bool IsInline() const { return limbs_.empty(); }
+
+  bool IsNegative() const { return IsInline() ? small_ < 0 : negative_; }
+
+  // Number of significant bits of the magnitude, 0 for 0.
+  std::size_t BitWidth() const {
+    if (IsInline()) {
+      return static_cast<std::size_t>(std::bit_width(InlineMagnitude()));
+    }
+    return limbs_.size() * 64 - static_cast<std::size_t>(std::countl_zero(limbs_.back()));
+  }
+
+  // The 64 bits of the magnitude from bit shift up.
+  std::uint64_t MagnitudeBits(std::size_t shift) const {
+    if (IsInline()) {
+      return shift < 64 ? InlineMagnitude() >> shift : 0;
+    }
+    auto index = shift / 64;
+    auto offset = shift % 64;
+    if (index >= limbs_.size()) {
+      return 0;
+    }
+    auto bits = limbs_[index] >> offset;
+    if (offset > 0 && index + 1 < limbs_.size()) {
+      bits |= limbs_[index + 1] << (64 - offset);
+    }
+    return bits;
+  }
+
+  // The value modulo modulus, in [0, modulus), without a BigInt division.
+  std::uint64_t Residue(std::uint64_t modulus) const {
+    std::uint64_t remainder;
+    if (IsInline()) {
+      remainder = InlineMagnitude() % modulus;
+    } else {
+      UInt128 wide = 0;
+      for (auto limb = limbs_.rbegin(); limb != limbs_.rend(); ++limb) {
+        wide = ((wide << 64) | *limb) % modulus;
+      }
+      remainder = static_cast<std::uint64_t>(wide);
+    }
+    return IsNegative() && remainder != 0 ? modulus - remainder : remainder;
+  }
+
+  explicit operator double() const {
+    if (IsInline()) {
+      return static_cast<double>(small_);
+    }
+    double result = 0;
+    for (auto limb = limbs_.rbegin(); limb != limbs_.rend(); ++limb) {
+      result = result * 0x1p64 + static_cast<double>(*limb);
+    }
+    return negative_ ? -result : result;
+  }
+
+  BigInt operator-() const {
+    if (IsInline() && small_ != std::numeric_limits<std::int64_t>::min()) {
+      return BigInt(-small_);
+    }
+    return FromMagnitude(Magnitude(), !IsNegative());
+  }
+
+  BigInt &operator+=(const BigInt &other) {
+    std::int64_t sum;
+    if (IsInline() && other.IsInline() && !__builtin_add_overflow(small_, other.small_, &sum)) {
+      small_ = sum;
+      return *this;
+    }
+    return *this = AddSigned(Magnitude(), IsNegative(), other.Magnitude(), other.IsNegative());
+  }
+
+  BigInt &operator-=(const BigInt &other) {
+    std::int64_t difference;
+    if (IsInline() && other.IsInline() &&
+        !__builtin_sub_overflow(small_, other.small_, &difference)) {
+      small_ = difference;
+      return *this;
+    }
+    return *this = AddSigned(Magnitude(), IsNegative(), other.Magnitude(), !other.IsNegative());
+  }
+
+  BigInt &operator*=(const BigInt &other) {
+    std::int64_t product;
+    if (IsInline() && other.IsInline() && !__builtin_mul_overflow(small_, other.small_, &product)) {
+      small_ = product;
+      return *this;
+    }
+    return *this = FromMagnitude(Multiply(Magnitude(), other.Magnitude()),
+                                 IsNegative() != other.IsNegative());
+  }
+
+  // Division truncates toward zero and the remainder takes the sign of the
+  // dividend, as for built-in integers. A zero divisor throws
+  // std::domain_error from DivMod.
+  BigInt &operator/=(const BigInt &other) {
+    if (IsInline() && other.IsInline() && other.small_ != 0 &&
+        !(small_ == std::numeric_limits<std::int64_t>::min() && other.small_ == -1)) {
+      small_ /= other.small_;
+      return *this;
+    }
+    return *this = FromMagnitude(DivMod(Magnitude(), other.Magnitude()).first,
+                                 IsNegative() != other.IsNegative());
+  }
+
+  BigInt &operator%=(const BigInt &other) {
+    if (IsInline() && other.IsInline() && other.small_ != 0) {
+      small_ = other.small_ == -1 ? 0 : small_ % other.small_;
+      return *this;
+    }
+    return *this = FromMagnitude(DivMod(Magnitude(), other.Magnitude()).second, IsNegative());
+  }
+
+  friend BigInt operator+(BigInt lhs, const BigInt &rhs) { return lhs += rhs; }
+  friend BigInt operator-(BigInt lhs, const BigInt &rhs) { return lhs -= rhs; }
+  friend BigInt operator*(BigInt lhs, const BigInt &rhs) { return lhs *= rhs; }
+  friend BigInt operator/(BigInt lhs, const BigInt &rhs) { return lhs /= rhs; }
+  friend BigInt operator%(BigInt lhs, const BigInt &rhs) { return lhs %= rhs; }
+
+  friend bool operator==(const BigInt &lhs, const BigInt &rhs) {
+    return lhs.small_ == rhs.small_ && lhs.negative_ == rhs.negative_ && lhs.limbs_ == rhs.limbs_;
+  }
+
+  friend std::strong_ordering operator<=>(const BigInt &lhs, const BigInt &rhs) {
+    if (lhs.IsInline() && rhs.IsInline()) {
+      return lhs.small_ <=> rhs.small_;
+    }
+    if (lhs.IsNegative() != rhs.IsNegative()) {
+      return rhs.IsNegative() <=> lhs.IsNegative();
+    }
+    auto order = Compare(lhs.Magnitude(), rhs.Magnitude());
+    return lhs.IsNegative() ? 0 <=> order : order <=> 0;
+  }
+
+  // A step of Lehmer's algorithm (TAOCP 4.5.2) for Euclid on (first,
+  // second), where first >= second and first has at least 62 bits: the
+  // quotients are found on the leading 62 bits of both for as long as they are
+  // certain, and their combined matrix {a, b, c, d} takes the pair to
+  // (a * first + b * second, c * first + d * second). nullopt when not even
+  // the first quotient is certain.
+  static std::optional<std::array<std::int64_t, 4>> LehmerStep(const BigInt &first,
+                                                               const BigInt &second) {
+    auto shift = first.BitWidth() - 62;
+    auto x = static_cast<std::int64_t>(first.MagnitudeBits(shift));
+    auto y = static_cast<std::int64_t>(second.MagnitudeBits(shift));
+    std::int64_t a = 1, b = 0, c = 0, d = 1;
+    while (y + c != 0 && y + d != 0) {
+      auto quotient = (x + a) / (y + c);
+      if (quotient != (x + b) / (y + d)) {
+        break;
+      }
+      a = std::exchange(c, a - quotient * c);
+      b = std::exchange(d, b - quotient * d);
+      x = std::exchange(y, x - quotient * y);
+    }
+    if (b == 0) {
+      return std::nullopt;
+    }
+    return std::array{a, b, c, d};
+  }
+
+  // Euclid on the limbs, in Lehmer steps while both values are long, until
+  // both fit inline; then the machine-word GCD. The result is never negative.
+  friend BigInt Gcd(BigInt a, BigInt b) {
+    a = a.IsNegative() ? -a : a;
+    b = b.IsNegative() ? -b : b;
+    while (!(a.IsInline() && b.IsInline())) {
+      if (b == 0) {
+        return a;
+      }
+      if (b.BitWidth() > 128 && a >= b) {
+        if (auto step = LehmerStep(a, b)) {
+          auto [p, q, r, t] = *step;
+          auto combined = a * BigInt(p) + b * BigInt(q);
+          b = a * BigInt(r) + b * BigInt(t);
+          a = std::move(combined);
+          continue;
+        }
+      }
+      a = std::exchange(b, a % b);
+    }
+    auto result = Gcd(a.InlineMagnitude(), b.InlineMagnitude());
+    return FromMagnitude(result == 0 ? Limbs{} : Limbs{result}, false);
+  }
+
+  friend std::ostream &operator<<(std::ostream &stream, const BigInt &value) {
+    if (value.IsInline()) {
+      return stream << value.small_;
+    }
+    std::vector<std::uint64_t> chunks;
+    auto magnitude = value.limbs_;
+    while (!magnitude.empty()) {
+      chunks.push_back(DivideSmall(magnitude, DECIMAL_CHUNK));
+    }
+    std::ostringstream digits;
+    digits << (value.negative_ ? "-" : "") << chunks.back();
+    digits.fill('0');
+    for (auto chunk = chunks.rbegin() + 1; chunk != chunks.rend(); ++chunk) {
+      digits.width(DECIMAL_CHUNK_DIGITS);
+      digits << *chunk;
+    }
+    return stream << digits.str();
+  }
+
+  // Reads an optional sign and the digits that follow it, stopping at the
+  // first other character.
+  friend std::istream &operator>>(std::istream &stream, BigInt &value) {
+    std::string digits;
+    stream >> std::ws;
+    if (stream.peek() == '-' || stream.peek() == '+') {
+      digits += static_cast<char>(stream.get());
+    }
+    while (std::isdigit(stream.peek())) {
+      digits += static_cast<char>(stream.get());
+    }
+    if (digits.empty() || !std::isdigit(static_cast<unsigned char>(digits.back()))) {
+      stream.setstate(std::ios::failbit);
+      return stream;
+    }
+    value = BigInt(digits);
+    return stream;
+  }
+
+private:
+  static constexpr std::uint64_t DECIMAL_CHUNK = 10000000000000000000ULL;
+  static constexpr std::size_t DECIMAL_CHUNK_DIGITS = 19;
+
+  std::uint64_t InlineMagnitude() const {
+    return small_ < 0 ? std::uint64_t(0) - static_cast<std::uint64_t>(small_)
+                      : static_cast<std::uint64_t>(small_);
+  }
+
+  Limbs Magnitude() const {
+    if (!IsInline()) {
+      return limbs_;
+    }
+    return small_ == 0 ? Limbs{} : Limbs{InlineMagnitude()};
+  }
+
+  static BigInt FromMagnitude(Limbs magnitude, bool negative) {
+    while (!magnitude.empty() && magnitude.back() == 0) {
+      magnitude.pop_back();
+    }
+    BigInt result;
+    if (magnitude.empty()) {
+      return result;
+    }
+    constexpr auto LIMIT = std::uint64_t(1) << 63;
+    if (magnitude.size() == 1 && (magnitude[0] < LIMIT || (negative && magnitude[0] == LIMIT))) {
+      result.small_ = negative ? static_cast<std::int64_t>(std::uint64_t(0) - magnitude[0])
+                               : static_cast<std::int64_t>(magnitude[0]);
+      return result;
+    }
+    result.limbs_ = std::move(magnitude);
+    result.negative_ = negative;
+    return result;
+  }
+
+  static int Compare(const Limbs &a, const Limbs &b) {
+    if (a.size() != b.size()) {
+      return a.size() < b.size() ? -1 : 1;
+    }
+    for (auto i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) {
+        return a[i] < b[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  static BigInt AddSigned(const Limbs &a, bool aNegative, const Limbs &b, bool bNegative) {
+    if (aNegative == bNegative) {
+      return FromMagnitude(Add(a, b), aNegative);
+    }
+    if (Compare(a, b) >= 0) {
+      return FromMagnitude(Subtract(a, b), aNegative);
+    }
+    return FromMagnitude(Subtract(b, a), bNegative);
+  }
+
+  static Limbs Add(const Limbs &a, const Limbs &b) {
+    const auto &longer = a.size() >= b.size() ? a : b;
+    const auto &shorter = a.size() >= b.size() ? b : a;
+    Limbs sum(longer.size() + 1);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < longer.size(); ++i) {
+      UInt128 limb = UInt128(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+      sum[i] = static_cast<std::uint64_t>(limb);
+      carry = static_cast<std::uint64_t>(limb >> 64);
+    }
+    sum.back() = carry;
+    return sum;
+  }
+
+  // a - b for a >= b.
+  static Limbs Subtract(const Limbs &a, const Limbs &b) {
+    Limbs difference(a.size());
+    std::uint64_t borrow = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      UInt128 limb = UInt128(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+      difference[i] = static_cast<std::uint64_t>(limb);
+      borrow = static_cast<std::uint64_t>(limb >> 64) != 0;
+    }
+    return difference;
+  }
+
+  static Limbs Multiply(const Limbs &a, const Limbs &b) {
+    if (a.empty() || b.empty()) {
+      return {};
+    }
+    Limbs product(a.size() + b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      std::uint64_t carry = 0;
+      for (std::size_t j = 0; j < b.size(); ++j) {
+        UInt128 limb = UInt128(a[i]) * b[j] + product[i + j] + carry;
+        product[i + j] = static_cast<std::uint64_t>(limb);
+        carry = static_cast<std::uint64_t>(limb >> 64);
+      }
+      product[i + b.size()] = carry;
+    }
+    return product;
+  }
+
+  // magnitude = magnitude * factor + addend.
+  static void MultiplyAdd(Limbs &magnitude, std::uint64_t factor, std::uint64_t addend) {
+    std::uint64_t carry = addend;
+    for (auto &limb : magnitude) {
+      UInt128 value = UInt128(limb) * factor + carry;
+      limb = static_cast<std::uint64_t>(value);
+      carry = static_cast<std::uint64_t>(value >> 64);
+    }
+    if (carry != 0) {
+      magnitude.push_back(carry);
+    }
+  }
+
+  // Divides magnitude in place by a single limb and returns the remainder.
+  static std::uint64_t DivideSmall(Limbs &magnitude, std::uint64_t divisor) {
+    UInt128 remainder = 0;
+    for (auto i = magnitude.size(); i-- > 0;) {
+      UInt128 value = (remainder << 64) | magnitude[i];
+      magnitude[i] = static_cast<std::uint64_t>(value / divisor);
+      remainder = value % divisor;
+    }
+    while (!magnitude.empty() && magnitude.back() == 0) {
+      magnitude.pop_back();
+    }
+    return static_cast<std::uint64_t>(remainder);
+  }
+
+  static Limbs ShiftLeft(const Limbs &magnitude, int shift, std::size_t size) {
+    Limbs result(size);
+    for (std::size_t i = 0; i < magnitude.size(); ++i) {
+      result[i] |= magnitude[i] << shift;
+      if (shift > 0 && i + 1 < size) {
+        result[i + 1] = magnitude[i] >> (64 - shift);
+      }
+    }
+    return result;
+  }
+
+  // Quotient and remainder of magnitudes by Knuth's Algorithm D (TAOCP
+  // 4.3.1) with 64-bit digits: the divisor is normalized so that its top bit
+  // is set, which makes each two-digit trial quotient at most two too large.
+  static std::pair<Limbs, Limbs> DivMod(const Limbs &a, const Limbs &b) {
+    if (b.empty()) {
+      throw std::domain_error("BigInt: division by zero");
+    }
+    if (Compare(a, b) < 0) {
+      return {{}, a};
+    }
+    if (b.size() == 1) {
+      auto quotient = a;
+      auto remainder = DivideSmall(quotient, b[0]);
+      return {quotient, Limbs{remainder}};
+    }
+
+    auto shift = std::countl_zero(b.back());
+    auto v = ShiftLeft(b, shift, b.size());
+    auto u = ShiftLeft(a, shift, a.size() + 1);
+    auto n = v.size();
+    auto m = u.size() - n;
+    Limbs quotient(m);
+    for (auto j = m; j-- > 0;) {
+      UInt128 numerator = (UInt128(u[j + n]) << 64) | u[j + n - 1];
+      UInt128 estimate = numerator / v[n - 1];
+      UInt128 remainder = numerator % v[n - 1];
+      while ((estimate >> 64) != 0 || estimate * v[n - 2] > ((remainder << 64) | u[j + n - 2])) {
+        --estimate;
+        remainder += v[n - 1];
+        if ((remainder >> 64) != 0) {
+          break;
+        }
+      }
+
+      std::uint64_t carry = 0;
+      std::uint64_t borrow = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        UInt128 product = estimate * v[i] + carry;
+        carry = static_cast<std::uint64_t>(product >> 64);
+        UInt128 difference = UInt128(u[i + j]) - static_cast<std::uint64_t>(product) - borrow;
+        u[i + j] = static_cast<std::uint64_t>(difference);
+        borrow = static_cast<std::uint64_t>(difference >> 64) != 0;
+      }
+      UInt128 top = UInt128(u[j + n]) - carry - borrow;
+      u[j + n] = static_cast<std::uint64_t>(top);
+
+      if ((top >> 64) != 0) {
+        --estimate;
+        std::uint64_t addCarry = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+          UInt128 sum = UInt128(u[i + j]) + v[i] + addCarry;
+          u[i + j] = static_cast<std::uint64_t>(sum);
+          addCarry = static_cast<std::uint64_t>(sum >> 64);
+        }
+        u[j + n] += addCarry;
+      }
+      quotient[j] = static_cast<std::uint64_t>(estimate);
+    }
+
+    Limbs remainder(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      remainder[i] = u[i] >> shift;
+      if (shift > 0) {
+        remainder[i] |= u[i + 1] << (64 - shift);
+      }
+    }
+    return {quotient, remainder};
+  }
+
+  std::int64_t small_ = 0;
+  bool negative_ = false;
+  Limbs limbs_;
+};
+
+// Signed integer type that holds any product of two values of T, or void if
+// there is none.
+template <typename T> struct Widened {
+  using Type = void;
+};
+
+template <std::signed_integral T>
+  requires(sizeof(T) <= 4)
+struct Widened<T> {
+  using Type = std::int64_t;
+};
+
+template <std::signed_integral T>
+  requires(sizeof(T) == 8)
+struct Widened<T> {
+  using Type = Int128;
+};
+
+// Fixed-width types whose products are checked for overflow and computed in
+// Widened<T> when they would overflow.
+template <typename T>
+concept CheckedInteger = std::signed_integral<T> && !std::is_void_v<typename Widened<T>::Type>;
+
+template <typename T> T AbsoluteGcd(T a, T b) {
+  a = a < 0 ? -a : a;
+  b = b < 0 ? -b : b;
+  while (b != 0) {
+    a = std::exchange(b, a % b);
+  }
+  return a;
+}
+
+// Whether a / b < c / d for positive b and d, compared through the continued
+// fractions of both sides so that nothing is multiplied and nothing overflows.
+template <typename Word> bool FractionLess(Word a, Word b, Word c, Word d) {
+  while (true) {
+    auto lhs = a / b;
+    auto rhs = c / d;
+    if (lhs != rhs) {
+      return lhs < rhs;
+    }
+    a -= lhs * b;
+    c -= rhs * d;
+    if (c == 0) {
+      return false;
+    }
+    if (a == 0) {
+      return true;
+    }
+    // a / b < c / d exactly when d / c < b / a.
+    std::swap(a, d);
+    std::swap(b, c);
+  }
+}
+
+// Best approximation h / k of p / q with h <= maxNum and 1 <= k <= maxDen.
+// Euclid's algorithm on (p, q) yields the partial quotients; the convergents
+// h1 / k1 only get closer, so the walk stops at the first one outside the
+// bounds and picks between the previous convergent and the largest
+// semiconvergent (m * h1 + h0) / (m * k1 + k0) inside them. The latter is
+// closer exactly when the complete quotient p / q is below 2m + k0 / k1.
+// Throws std::overflow_error when even the integer part exceeds maxNum.
+template <typename Word>
+std::pair<std::uint64_t, std::uint64_t> BoundedContinuedFraction(Word p, Word q,
+                                                                  std::uint64_t maxNum,
+                                                                  std::uint64_t maxDen) {
+  std::uint64_t h0 = 0;
+  std::uint64_t h1 = 1;
+  std::uint64_t k0 = 1;
+  std::uint64_t k1 = 0;
+  while (true) {
+    auto quotient = p / q;
+    auto limit = ~Word(0);
+    if (h1 != 0) {
+      limit = (maxNum - h0) / h1;
+    }
+    if (k1 != 0) {
+      limit = std::min<Word>(limit, (maxDen - k0) / k1);
+    }
+    if (quotient > limit) {
+      if (k1 == 0) {
+        throw std::overflow_error("Rational: value does not fit");
+      }
+      auto m = static_cast<std::uint64_t>(limit);
+      if (m >= 1 && FractionLess<UInt128>(p, q, UInt128(2 * m) * k1 + k0, k1)) {
+        return {m * h1 + h0, m * k1 + k0};
+      }
+      return {h1, k1};
+    }
+    auto a = static_cast<std::uint64_t>(quotient);
+    h0 = std::exchange(h1, a * h1 + h0);
+    k0 = std::exchange(k1, a * k1 + k0);
+    auto remainder = p - quotient * q;
+    if (remainder == 0) {
+      return {h1, k1};
+    }
+    p = std::exchange(q, remainder);
+  }
+}
+
+// Best approximation of a finite x >= 0, through its exact value
+// mantissa / 2^scale. Below 2^-67 the answer is 0 for any 64-bit bound, so
+// scale stays within 128 bits, and within 64 for the common magnitudes.
+inline std::pair<std::uint64_t, std::uint64_t> BestApproximation(double x, std::uint64_t maxNum,
+                                                                 std::uint64_t maxDen) {
+  int exponent = 0;
+  auto mantissa = static_cast<std::uint64_t>(std::ldexp(std::frexp(x, &exponent), 53));
+  auto scale = 53 - exponent;
+  if (mantissa == 0 || scale > 120) {
+    return {0, 1};
+  }
+  if (scale <= 0) {
+    if (x >= 0x1p64 || static_cast<std::uint64_t>(x) > maxNum) {
+      throw std::overflow_error("Rational: value does not fit");
+    }
+    return {static_cast<std::uint64_t>(x), 1};
+  }
+  auto zeros = std::min(std::countr_zero(mantissa), scale);
+  mantissa >>= zeros;
+  scale -= zeros;
+  if (scale < 64) {
+    return BoundedContinuedFraction<std::uint64_t>(mantissa, std::uint64_t(1) << scale, maxNum,
+                                                   maxDen);
+  }
+  return BoundedContinuedFraction<UInt128>(mantissa, UInt128(1) << scale, maxNum, maxDen);
+}
+
+// num / den correctly rounded to double, den > 0. Below 2^53 both convert
+// exactly and the division rounds once. Otherwise the quotient is taken in
+// 128-bit integers with at least 64 significant bits and rounded to nearest
+// even by hand, the remainder serving as the sticky bit.
+inline double RoundedQuotient(std::uint64_t num, std::uint64_t den) {
+  if (num < (std::uint64_t(1) << 53) && den < (std::uint64_t(1) << 53)) {
+    return static_cast<double>(num) / static_cast<double>(den);
+  }
+  if (num == 0) {
+    return 0.0;
+  }
+  auto shift = std::countl_zero(num) + 64;
+  auto scaled = UInt128(num) << shift;
+  auto quotient = scaled / den;
+  auto sticky = scaled % den != 0;
+  auto high = static_cast<std::uint64_t>(quotient >> 64);
+  auto bits = high != 0 ? 128 - std::countl_zero(high) : 64;
+  auto dropped = bits - 53;
+  auto mantissa = static_cast<std::uint64_t>(quotient >> dropped);
+  auto rest = quotient & ((UInt128(1) << dropped) - 1);
+  auto half = UInt128(1) << (dropped - 1);
+  if (rest > half || (rest == half && (sticky || (mantissa & 1) != 0))) {
+    ++mantissa;
+  }
+  return std::ldexp(static_cast<double>(mantissa), dropped - shift);
+}
+
+// Eager keeps every value in lowest terms. Lazy skips the GCDs in arithmetic
+// and reduces only when an intermediate would overflow (for BigInt, when a
+// denominator would pass LAZY_REDUCE_BITS), on output, or on an explicit
+// Normalize(); comparisons cross-multiply and need no reduction.
+enum class Normalization { Eager, Lazy };
+
+template <typename T, Normalization N = Normalization::Eager> class Rational {
 public:
-  Rational(T num = 0, T den = 1) : num_(num), den_(den) { Reduce(); }
+  Rational(T num = 0, T den = 1) : num_(num), den_(den) {
+    if constexpr (N == Normalization::Lazy) {
+      if (den_ < 0) {
+        num_ = -num_;
+        den_ = -den_;
+      }
+    } else {
+      Reduce();
+    }
+  }
+
+  // Correctly rounded for the built-in types: 32-bit values convert exactly,
+  // and 64-bit ones go through RoundedQuotient.
+  explicit operator double() const {
+    if constexpr (std::integral<T> && sizeof(T) == 8) {
+      auto magnitude = num_ < 0 ? std::uint64_t(0) - static_cast<std::uint64_t>(num_)
+                                : static_cast<std::uint64_t>(num_);
+      auto value = RoundedQuotient(magnitude, static_cast<std::uint64_t>(den_));
+      return num_ < 0 ? -value : value;
+    } else {
+      return static_cast<double>(num_) / static_cast<double>(den_);
+    }
+  }
+
+  // The closest fraction to x with a denominator up to maxDen and a
+  // numerator that fits in T, found by BestApproximation on the exact value
+  // of x. Throws std::invalid_argument for NaN, infinities or maxDen < 1 and
+  // std::overflow_error when the integer part of x does not fit.
+  static Rational FromDouble(double x, T maxDen = std::numeric_limits<T>::max())
+    requires std::integral<T>
+  {
+    if (!std::isfinite(x) || maxDen < 1) {
+      throw std::invalid_argument("Rational: no approximation of a non-finite value");
+    }
+    auto [num, den] = BestApproximation(std::abs(x),
+                                        static_cast<std::uint64_t>(std::numeric_limits<T>::max()),
+                                        static_cast<std::uint64_t>(maxDen));
+    return Rational(x < 0 ? -static_cast<T>(num) : static_cast<T>(num), static_cast<T>(den));
+  }
+
+  // Brings the value to lowest terms; only needed in the lazy mode.
+  void Normalize() { Reduce(); }
+
+  // In lowest terms with a positive denominator, except in the lazy mode
+  // before Normalize().
+  const T &Numerator() const { return num_; }
+  const T &Denominator() const { return den_; }
+
+  Rational &operator+=(const Rational &other) {
+    if constexpr (N == Normalization::Lazy) {
+      if (TryAddUnreduced(other)) {
+        return *this;
+      }
+      Reduce();
+      auto reduced = other;
+      reduced.Reduce();
+      return AddReduced(reduced);
+    }
+    return AddReduced(other);
+  }
+
+  Rational &operator-=(const Rational &other) {
+    return *this += Rational(-other.num_, other.den_);
+  }
+
+  Rational &operator*=(const Rational &other) {
+    if constexpr (N == Normalization::Lazy) {
+      if (TryMultiplyUnreduced(other)) {
+        return *this;
+      }
+      Reduce();
+      auto reduced = other;
+      reduced.Reduce();
+      return MultiplyReduced(reduced);
+    }
+    return MultiplyReduced(other);
+  }
+
+  Rational &operator/=(const Rational &other) {
+    return *this *= Rational(other.den_, other.num_);
+  }
+
+  const Rational operator++(int) {
+    auto temp = *this;
+    *this += Rational(1);
+    return temp;
+  }
+
+  const Rational operator--(int) {
+    auto temp = *this;
+    *this -= Rational(1);
+    return temp;
+  }
+
+  Rational &operator++() {
+    *this += Rational(1);
+    return *this;
+  }
+
+  Rational &operator--() {
+    *this -= Rational(1);
+    return *this;
+  }
+
+  friend Rational operator+(Rational lhs, const Rational &rhs) {
+    return lhs += rhs;
+  }
+
+  friend Rational operator-(Rational lhs, const Rational &rhs) {
+    return lhs -= rhs;
+  }
+
+  friend Rational operator*(Rational lhs, const Rational &rhs) {
+    return lhs *= rhs;
+  }
+
+  friend Rational operator/(Rational lhs, const Rational &rhs) {
+    return lhs /= rhs;
+  }
+
+  friend std::strong_ordering operator<=>(const Rational &lhs,
+                                          const Rational &rhs) {
+    if constexpr (CheckedInteger<T>) {
+      using Wide = typename Widened<T>::Type;
+      return Wide(lhs.num_) * rhs.den_ <=> Wide(rhs.num_) * lhs.den_;
+    } else {
+      // Types without a wider one, like BigInt, compare the double
+      // approximations first and multiply only when those are too close to
+      // decide. The approximations are trusted only when every part is a
+      // normal double: an operand that overflows to infinity or underflows
+      // to zero makes its quotient meaningless.
+      auto lhsNum = static_cast<double>(lhs.num_);
+      auto lhsDen = static_cast<double>(lhs.den_);
+      auto rhsNum = static_cast<double>(rhs.num_);
+      auto rhsDen = static_cast<double>(rhs.den_);
+      auto lhsApproximation = lhsNum / lhsDen;
+      auto rhsApproximation = rhsNum / rhsDen;
+      auto gap = lhsApproximation - rhsApproximation;
+      if (std::isnormal(lhsNum) && std::isnormal(lhsDen) && std::isnormal(rhsNum) &&
+          std::isnormal(rhsDen) && std::isnormal(lhsApproximation) &&
+          std::isnormal(rhsApproximation) && std::isfinite(gap) &&
+          std::abs(gap) > APPROXIMATION_TOLERANCE *
+                              (std::abs(lhsApproximation) + std::abs(rhsApproximation))) {
+        return gap < 0 ? std::strong_ordering::less : std::strong_ordering::greater;
+      }
+      return (lhs.num_ * rhs.den_) <=> (rhs.num_ * lhs.den_);
+    }
+  }
+
+  friend bool operator==(const Rational &lhs, const Rational &rhs) {
+    if constexpr (N == Normalization::Lazy) {
+      return (lhs <=> rhs) == 0;
+    } else {
+      return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+    }
+  }
+
+  friend std::istream &operator>>(std::istream &stream, Rational &rational) {
+    char slash = 0;
+    stream >> rational.num_ >> slash >> rational.den_;
+    rational.Reduce();
+    return stream;
+  }
+
+  friend std::ostream &operator<<(std::ostream &stream,
+                                  const Rational &rational) {
+    if constexpr (N == Normalization::Lazy) {
+      auto reduced = rational;
+      reduced.Reduce();
+      return stream << reduced.num_ << '/' << reduced.den_;
+    } else {
+      return stream << rational.num_ << '/' << rational.den_;
+    }
+  }
+
+private:
+  // Knuth, TAOCP 4.5.1: with d1 = gcd(den_, other.den_) the sum is
+  // t / (den_ / d1 * other.den_) for t = num_ * (other.den_ / d1) +
+  // other.num_ * (den_ / d1), and only d2 = gcd(t, d1) can still divide it,
+  // so the second GCD works on small operands and no Reduce follows. Checked
+  // types redo an overflowing sum in Widened<T>, which throws
+  // std::overflow_error only when the reduced result itself does not fit.
+  Rational &AddReduced(const Rational &other) {
+    auto common = Gcd(den_, other.den_);
+    auto lhsScale = other.den_ / common;
+    auto rhsScale = den_ / common;
+    T sum;
+    if constexpr (CheckedInteger<T>) {
+      T lhs;
+      T rhs;
+      if (__builtin_mul_overflow(num_, lhsScale, &lhs) ||
+          __builtin_mul_overflow(other.num_, rhsScale, &rhs) ||
+          __builtin_add_overflow(lhs, rhs, &sum)) {
+        using Wide = typename Widened<T>::Type;
+        return *this = Narrow(Wide(num_) * lhsScale + Wide(other.num_) * rhsScale,
+                              Wide(den_) * lhsScale);
+      }
+    } else {
+      sum = num_ * lhsScale + other.num_ * rhsScale;
+    }
+    if (sum == 0) {
+      num_ = 0;
+      den_ = 1;
+      return *this;
+    }
+    auto remaining = Gcd(sum, common);
+    T den;
+    if constexpr (CheckedInteger<T>) {
+      if (__builtin_mul_overflow(rhsScale, other.den_ / remaining, &den)) {
+        throw std::overflow_error("Rational: result does not fit");
+      }
+    } else {
+      den = rhsScale * (other.den_ / remaining);
+    }
+    num_ = sum / remaining;
+    den_ = den;
+    return *this;
+  }
+
+  // Cancels num_ against other.den_ and other.num_ against den_ before
+  // multiplying. Both operands are in lowest terms, so the product is too and
+  // needs no Reduce, and an overflow in it is a real one.
+  Rational &MultiplyReduced(const Rational &other) {
+    auto left = Gcd(num_, other.den_);
+    auto right = Gcd(other.num_, den_);
+    if constexpr (CheckedInteger<T>) {
+      T num;
+      T den;
+      if (__builtin_mul_overflow(num_ / left, other.num_ / right, &num) ||
+          __builtin_mul_overflow(den_ / right, other.den_ / left, &den)) {
+        throw std::overflow_error("Rational: product does not fit");
+      }
+      num_ = num;
+      den_ = den;
+    } else {
+      num_ = (num_ / left) * (other.num_ / right);
+      den_ = (den_ / right) * (other.den_ / left);
+    }
+    return *this;
+  }
+
+  // The lazy sum and product without any GCD. They return false, leaving
+  // *this unchanged, when an intermediate of a checked type would overflow or
+  // a BigInt denominator would pass LAZY_REDUCE_BITS.
+  bool TryAddUnreduced(const Rational &other) {
+    if constexpr (CheckedInteger<T>) {
+      T lhs;
+      T rhs;
+      T num;
+      T den;
+      if (__builtin_mul_overflow(num_, other.den_, &lhs) ||
+          __builtin_mul_overflow(other.num_, den_, &rhs) ||
+          __builtin_add_overflow(lhs, rhs, &num) ||
+          __builtin_mul_overflow(den_, other.den_, &den)) {
+        return false;
+      }
+      num_ = num;
+      den_ = den;
+    } else {
+      if (!FitsUnreduced(other)) {
+        return false;
+      }
+      num_ = num_ * other.den_ + other.num_ * den_;
+      den_ *= other.den_;
+    }
+    return true;
+  }
+
+  bool TryMultiplyUnreduced(const Rational &other) {
+    if constexpr (CheckedInteger<T>) {
+      T num;
+      T den;
+      if (__builtin_mul_overflow(num_, other.num_, &num) ||
+          __builtin_mul_overflow(den_, other.den_, &den)) {
+        return false;
+      }
+      num_ = num;
+      den_ = den;
+    } else {
+      if (!FitsUnreduced(other)) {
+        return false;
+      }
+      num_ *= other.num_;
+      den_ *= other.den_;
+    }
+    return true;
+  }
+
+  bool FitsUnreduced(const Rational &other) const {
+    if constexpr (requires { den_.BitWidth(); }) {
+      return den_.BitWidth() + other.den_.BitWidth() <= LAZY_REDUCE_BITS;
+    }
+    return true;
+  }
+
+  // Reduces an exact result computed in a wider type and narrows it back to
+  // T. The denominator must be positive.
+  template <typename Wide> static Rational Narrow(Wide num, Wide den) {
+    auto common = AbsoluteGcd(num, den);
+    num /= common;
+    den /= common;
+    if (num < std::numeric_limits<T>::min() || num > std::numeric_limits<T>::max() ||
+        den > std::numeric_limits<T>::max()) {
+      throw std::overflow_error("Rational: result does not fit");
+    }
+    Rational result;
+    result.num_ = static_cast<T>(num);
+    result.den_ = static_cast<T>(den);
+    return result;
+  }
+
+  void Reduce() {
+    if (den_ < 0) {
+      num_ = -num_;
+      den_ = -den_;
+    }
+    auto common = Gcd(num_, den_);
+    num_ /= common;
+    den_ /= common;
+  }
+
+  T num_ = 0;
+  T den_ = 1;
+};
+
+// Folds the 128-bit product of a and b into 64 bits, so that every output
+// bit depends on nearly all input bits.
+inline std::uint64_t FoldMultiply(std::uint64_t a, std::uint64_t b) {
+  auto product = UInt128(a) * b;
+  return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+}
+
+// Equal values share their reduced form, so hashing (num_, den_) with one
+// multiplication is consistent with ==. Lazy values are reduced first.
+template <std::integral T, Normalization N> struct std::hash<Rational<T, N>> {
+  std::size_t operator()(Rational<T, N> rational) const noexcept {
+    if constexpr (N == Normalization::Lazy) {
+      rational.Normalize();
+    }
+    return FoldMultiply(static_cast<std::uint64_t>(rational.Numerator()) ^ HASH_SEEDS[0],
+                        static_cast<std::uint64_t>(rational.Denominator()) ^ HASH_SEEDS[1]);
+  }
+};
+
+// Mapped type of FlatHashSet; [[no_unique_address]] keeps it out of the slot.
+struct NoValue {};
+
+// Open-addressing hash map with linear probing, meant for small keys like
+// Rational<int> and Rational<long long>. Entries live inline in one array,
+// and a parallel array of control bytes holds a 7-bit fingerprint of each
+// occupied slot's hash, so probes scan dense bytes and compare keys only on
+// a fingerprint match. Hashes are mixed once more with FoldMultiply, since
+// some (std::hash of an integer is the identity) leave the high bits empty;
+// the high bits of the mix pick the home slot and its low bits the
+// fingerprint. Erase
+// shifts the rest of the cluster back instead of leaving tombstones, so a
+// lookup never probes past the end of its cluster.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+  requires std::default_initializable<Key> && std::default_initializable<Value>
+class FlatHashMap {
+public:
+  explicit FlatHashMap(std::size_t count = 0) { Rehash(SlotsFor(count)); }
+
+  std::size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+
+  // Makes room for count entries without further rehashing.
+  void Reserve(std::size_t count) {
+    if (SlotsFor(count) > control_.size()) {
+      Rehash(SlotsFor(count));
+    }
+  }
+
+  // Inserts key with value unless key is present. Returns the mapped value
+  // of key and whether it was inserted.
+  std::pair<Value *, bool> Insert(const Key &key, Value value = {}) {
+    auto hash = HashOf(key);
+    auto [index, found] = Probe(key, hash);
+    if (!found) {
+      if (size_ + 1 > control_.size() / 8 * 7) {
+        Rehash(control_.size() * 2);
+        index = Probe(key, hash).first;
+      }
+      control_[index] = Tag(hash);
+      slots_[index] = {key, std::move(value)};
+      ++size_;
+    }
+    return {&slots_[index].value, !found};
+  }
+
+  Value &operator[](const Key &key) { return *Insert(key).first; }
+
+  Value *Find(const Key &key) {
+    auto [index, found] = Probe(key, HashOf(key));
+    return found ? &slots_[index].value : nullptr;
+  }
+
+  const Value *Find(const Key &key) const {
+    auto [index, found] = Probe(key, HashOf(key));
+    return found ? &slots_[index].value : nullptr;
+  }
+
+  bool Contains(const Key &key) const { return Probe(key, HashOf(key)).second; }
+
+  bool Erase(const Key &key) {
+    auto [index, found] = Probe(key, HashOf(key));
+    if (!found) {
+      return false;
+    }
+    // An entry may fill the hole if the hole lies between its home slot and
+    // its current one; it then leaves a hole of its own.
+    auto mask = control_.size() - 1;
+    for (auto next = (index + 1) & mask; control_[next] != EMPTY; next = (next + 1) & mask) {
+      auto home = Home(HashOf(slots_[next].key));
+      if (((next - home) & mask) >= ((next - index) & mask)) {
+        control_[index] = control_[next];
+        slots_[index] = std::move(slots_[next]);
+        index = next;
+      }
+    }
+    control_[index] = EMPTY;
+    slots_[index] = {};
+    --size_;
+    return true;
+  }
+
+  // Calls function(key, value) for every entry, in no particular order.
+  template <typename Function> void ForEach(Function function) const {
+    for (std::size_t i = 0; i < control_.size(); ++i) {
+      if (control_[i] != EMPTY) {
+        function(slots_[i].key, slots_[i].value);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    Key key;
+    [[no_unique_address]] Value value;
+  };
+
+  static constexpr std::uint8_t EMPTY = 0;
+
+  static std::size_t SlotsFor(std::size_t count) {
+    return std::bit_ceil(std::max(count + count / 7 + 1, FLAT_HASH_MIN_SLOTS));
+  }
+
+  std::uint64_t HashOf(const Key &key) const {
+    return FoldMultiply(static_cast<std::uint64_t>(hash_(key)), HASH_SEEDS[0]);
+  }
+
+  static std::uint8_t Tag(std::uint64_t hash) {
+    return static_cast<std::uint8_t>(0x80 | (hash & 0x7f));
+  }
+
+  std::size_t Home(std::uint64_t hash) const {
+    return static_cast<std::size_t>(hash >> shift_);
+  }
+
+  // Returns the slot holding key, or the empty slot that ends its probe
+  // sequence. The load limit guarantees that there is one.
+  std::pair<std::size_t, bool> Probe(const Key &key, std::uint64_t hash) const {
+    auto mask = control_.size() - 1;
+    auto tag = Tag(hash);
+    for (auto index = Home(hash);; index = (index + 1) & mask) {
+      if (control_[index] == EMPTY) {
+        return {index, false};
+      }
+      if (control_[index] == tag && slots_[index].key == key) {
+        return {index, true};
+      }
+    }
+  }
+
+  void Rehash(std::size_t count) {
+    auto control = std::exchange(control_, std::vector<std::uint8_t>(count, EMPTY));
+    auto slots = std::exchange(slots_, std::vector<Slot>(count));
+    shift_ = 64 - std::countr_zero(count);
+    auto mask = count - 1;
+    for (std::size_t i = 0; i < control.size(); ++i) {
+      if (control[i] != EMPTY) {
+        auto index = Home(HashOf(slots[i].key));
+        while (control_[index] != EMPTY) {
+          index = (index + 1) & mask;
+        }
+        control_[index] = control[i];
+        slots_[index] = std::move(slots[i]);
+      }
+    }
+  }
+
+  std::vector<std::uint8_t> control_;
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+  int shift_ = 64;
+  [[no_unique_address]] Hash hash_;
+};
+
+// FlatHashMap without mapped values.
+template <typename Key, typename Hash = std::hash<Key>> class FlatHashSet {
+public:
+  explicit FlatHashSet(std::size_t count = 0) : map_(count) {}
+
+  std::size_t Size() const { return map_.Size(); }
+  bool Empty() const { return map_.Empty(); }
+  void Reserve(std::size_t count) { map_.Reserve(count); }
+
+  // Returns whether key was not present yet.
+  bool Insert(const Key &key) { return map_.Insert(key).second; }
+  bool Contains(const Key &key) const { return map_.Contains(key); }
+  bool Erase(const Key &key) { return map_.Erase(key); }
+
+  template <typename Function> void ForEach(Function function) const {
+    map_.ForEach([&](const Key &key, NoValue) { function(key); });
+  }
+
+private:
+  FlatHashMap<Key, NoValue, Hash> map_;
+};
+
+// Calls work(begin, end) on up to threadCount slices of [0, count) at once,
+// the first one on the calling thread.
+template <typename Work> void ForEachSlice(std::size_t count, std::size_t threadCount, Work work) {
+  threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(count, 1));
+  auto slice = (count + threadCount - 1) / threadCount;
+  std::vector<std::future<void>> pending;
+  for (auto begin = slice; begin < count; begin += slice) {
+    pending.push_back(std::async(std::launch::async, work, begin, std::min(count, begin + slice)));
+  }
+  work(std::size_t(0), std::min(count, slice));
+  for (auto &task : pending) {
+    task.get();
+  }
+}
+
+// Integer arithmetic of RationalMatrix. Checked types throw
+// std::overflow_error where a result does not fit; the others, like BigInt,
+// cannot overflow.
+template <typename T> T CheckedMultiply(const T &lhs, const T &rhs) {
+  if constexpr (CheckedInteger<T>) {
+    T product;
+    if (__builtin_mul_overflow(lhs, rhs, &product)) {
+      throw std::overflow_error("RationalMatrix: entry does not fit");
+    }
+    return product;
+  } else {
+    return lhs * rhs;
+  }
+}
+
+template <typename T> T CheckedSubtract(const T &lhs, const T &rhs) {
+  if constexpr (CheckedInteger<T>) {
+    T difference;
+    if (__builtin_sub_overflow(lhs, rhs, &difference)) {
+      throw std::overflow_error("RationalMatrix: entry does not fit");
+    }
+    return difference;
+  } else {
+    return lhs - rhs;
+  }
+}
+
+// (pivot * x - factor * y) / previous, a division the caller knows to be
+// exact. Checked types take the products in Widened<T>, so only a quotient
+// that does not fit overflows.
+template <typename T>
+T FractionFreeUpdate(const T &pivot, const T &x, const T &factor, const T &y, const T &previous) {
+  if constexpr (CheckedInteger<T>) {
+    using Wide = typename Widened<T>::Type;
+    Wide difference;
+    if (__builtin_sub_overflow(Wide(pivot) * x, Wide(factor) * y, &difference)) {
+      throw std::overflow_error("RationalMatrix: entry does not fit");
+    }
+    auto quotient = difference / previous;
+    if (quotient < std::numeric_limits<T>::min() || quotient > std::numeric_limits<T>::max()) {
+      throw std::overflow_error("RationalMatrix: entry does not fit");
+    }
+    return static_cast<T>(quotient);
+  } else {
+    return (pivot * x - factor * y) / previous;
+  }
+}
+
+// Dense row-major matrix of Rational<T> for exact linear algebra. Gaussian
+// elimination over fractions reduces after every operation and still lets
+// the entries grow exponentially. The solvers here instead scale each row by
+// the LCM of its denominators and run Bareiss' fraction-free elimination on
+// the integer matrix: every entry it produces is a minor of the input, every
+// division in it is exact, and fractions appear only in the results. T must
+// hold those minors, which in general takes BigInt; fixed-width types throw
+// std::overflow_error when an entry does not fit. The row updates of each
+// step run over tiles of MATRIX_BLOCK columns, so the pivot row stays in
+// cache, and are split among threadCount threads when the step is large.
+template <typename T> class RationalMatrix {
+public:
+  using Value = Rational<T>;
+
+  RationalMatrix(std::size_t rows, std::size_t cols)
+      : rows_(rows), cols_(cols), values_(rows * cols) {}
+
+  // Takes the entries row by row.
+  RationalMatrix(std::size_t rows, std::size_t cols, std::vector<Value> values)
+      : rows_(rows), cols_(cols), values_(std::move(values)) {
+    if (values_.size() != rows * cols) {
+      throw std::invalid_argument("RationalMatrix: entry count does not match the shape");
+    }
+  }
+
+  static RationalMatrix Identity(std::size_t size) {
+    RationalMatrix identity(size, size);
+    for (std::size_t i = 0; i < size; ++i) {
+      identity(i, i) = Value(1);
+    }
+    return identity;
+  }
+
+  std::size_t Rows() const { return rows_; }
+  std::size_t Cols() const { return cols_; }
+
+  Value &operator()(std::size_t row, std::size_t col) { return values_[row * cols_ + col]; }
+  const Value &operator()(std::size_t row, std::size_t col) const {
+    return values_[row * cols_ + col];
+  }
+
+  friend bool operator==(const RationalMatrix &lhs, const RationalMatrix &rhs) = default;
+
+  friend RationalMatrix operator*(const RationalMatrix &lhs, const RationalMatrix &rhs) {
+    if (lhs.cols_ != rhs.rows_) {
+      throw std::invalid_argument("RationalMatrix: shapes do not match");
+    }
+    RationalMatrix product(lhs.rows_, rhs.cols_);
+    for (std::size_t i = 0; i < lhs.rows_; ++i) {
+      for (std::size_t k = 0; k < lhs.cols_; ++k) {
+        for (std::size_t j = 0; j < rhs.cols_; ++j) {
+          product(i, j) += lhs(i, k) * rhs(k, j);
+        }
+      }
+    }
+    return product;
+  }
+
+  // Throws std::invalid_argument unless the matrix is square. The empty
+  // matrix has determinant 1.
+  Value Determinant(std::size_t threadCount = 1) const {
+    RequireSquare();
+    if (rows_ == 0) {
+      return Value(1);
+    }
+    auto scaled = ScaledRows(nullptr);
+    bool negated = false;
+    auto pivots = Eliminate(scaled.entries, rows_, cols_, cols_, negated, threadCount);
+    if (pivots.size() < rows_) {
+      return Value(0);
+    }
+    const auto &last = scaled.entries.back();
+    Value determinant(negated ? -last : last);
+    for (const auto &scale : scaled.scales) {
+      determinant /= Value(scale);
+    }
+    return determinant;
+  }
+
+  std::size_t Rank(std::size_t threadCount = 1) const {
+    auto scaled = ScaledRows(nullptr);
+    bool negated = false;
+    return Eliminate(scaled.entries, rows_, cols_, cols_, negated, threadCount).size();
+  }
 
-  explicit operator double() const {
-    return static_cast<double>(num_) / static_cast<double>(den_);
+  // The X with *this * X == rhs. Throws std::invalid_argument for a
+  // non-square matrix or mismatched rhs and std::domain_error when the matrix
+  // is singular. After the elimination of [*this | rhs] the last pivot d is
+  // the determinant of the scaled matrix and d * X is an integer matrix, so
+  // the back substitution X_i = (d * c_i - sum U_ij X_j) / U_ii divides
+  // exactly too. It runs per column of rhs, in parallel.
+  RationalMatrix Solve(const RationalMatrix &rhs, std::size_t threadCount = 1) const {
+    RequireSquare();
+    if (rhs.rows_ != rows_) {
+      throw std::invalid_argument("RationalMatrix: shapes do not match");
+    }
+    if (rows_ == 0) {
+      return RationalMatrix(0, rhs.cols_);
+    }
+    auto width = cols_ + rhs.cols_;
+    auto scaled = ScaledRows(&rhs);
+    auto &entries = scaled.entries;
+    bool negated = false;
+    if (Eliminate(entries, rows_, width, cols_, negated, threadCount).size() < rows_) {
+      throw std::domain_error("RationalMatrix: singular matrix");
+    }
+    auto size = rows_;
+    const auto &determinant = entries[(size - 1) * width + size - 1];
+    RationalMatrix solution(size, rhs.cols_);
+    ForEachSlice(rhs.cols_, threadCount, [&](std::size_t begin, std::size_t end) {
+      std::vector<T> scaledSolution(size);
+      for (auto k = begin; k < end; ++k) {
+        for (auto i = size; i-- > 0;) {
+          const T *row = &entries[i * width];
+          auto sum = CheckedMultiply(determinant, row[size + k]);
+          for (auto j = i + 1; j < size; ++j) {
+            sum = CheckedSubtract(sum, CheckedMultiply(row[j], scaledSolution[j]));
+          }
+          scaledSolution[i] = sum / row[i];
+          solution(i, k) = Value(scaledSolution[i], determinant);
+        }
+      }
+    });
+    return solution;
   }
 
-  Rational &operator+=(const Rational &other) {
-    auto lcm = std::lcm(den_, other.den_);
-    num_ = num_ * (lcm / den_) + other.num_ * (lcm / other.den_);
-    den_ = lcm;
-    Reduce();
-    return *this;
+  // Solve against the identity, with the same exceptions.
+  RationalMatrix Inverse(std::size_t threadCount = 1) const {
+    return Solve(Identity(rows_), threadCount);
   }
 
-  Rational &operator-=(const Rational &other) {
-    return *this += Rational(-other.num_, other.den_);
+private:
+  struct ScaledMatrix {
+    std::vector<T> entries;
+    std::vector<T> scales;
+  };
+
+  void RequireSquare() const {
+    if (rows_ != cols_) {
+      throw std::invalid_argument("RationalMatrix: matrix is not square");
+    }
   }
 
-  Rational &operator*=(const Rational &other) {
-    num_ *= other.num_;
-    den_ *= other.den_;
-    Reduce();
-    return *this;
+  // The rows of [*this | *rhs], each multiplied by the LCM of its
+  // denominators, and those LCMs.
+  ScaledMatrix ScaledRows(const RationalMatrix *rhs) const {
+    auto extra = rhs != nullptr ? rhs->cols_ : 0;
+    ScaledMatrix scaled;
+    scaled.entries.reserve(rows_ * (cols_ + extra));
+    scaled.scales.reserve(rows_);
+    for (std::size_t i = 0; i < rows_; ++i) {
+      std::span<const Value> left(&values_[i * cols_], cols_);
+      std::span<const Value> right;
+      if (rhs != nullptr) {
+        right = std::span<const Value>(&rhs->values_[i * extra], extra);
+      }
+      T scale(1);
+      for (auto part : {left, right}) {
+        for (const auto &value : part) {
+          scale = CheckedMultiply(T(scale / Gcd(scale, value.Denominator())), value.Denominator());
+        }
+      }
+      for (auto part : {left, right}) {
+        for (const auto &value : part) {
+          scaled.entries.push_back(
+              CheckedMultiply(value.Numerator(), T(scale / value.Denominator())));
+        }
+      }
+      scaled.scales.push_back(std::move(scale));
+    }
+    return scaled;
   }
 
-  Rational &operator/=(const Rational &other) {
-    return *this *= Rational(other.den_, other.num_);
+  // Bareiss' elimination of the first pivotCols columns of the rows x width
+  // integer matrix in entries, in place. Each step takes the first nonzero
+  // entry p of the next column as pivot and replaces every entry x below the
+  // pivot row by (p * x - f * y) / q, where f is the entry of its row in the
+  // pivot column, y the one of the pivot row in its column and q the previous
+  // pivot. Returns the pivot column of each pivot row; negated tells whether
+  // the row swaps flipped the determinant.
+  static std::vector<std::size_t> Eliminate(std::vector<T> &entries, std::size_t rows,
+                                            std::size_t width, std::size_t pivotCols, bool &negated,
+                                            std::size_t threadCount) {
+    std::vector<std::size_t> pivots;
+    T previous(1);
+    for (std::size_t col = 0; col < pivotCols && pivots.size() < rows; ++col) {
+      auto row = pivots.size();
+      auto found = row;
+      while (found < rows && entries[found * width + col] == 0) {
+        ++found;
+      }
+      if (found == rows) {
+        continue;
+      }
+      if (found != row) {
+        std::swap_ranges(entries.begin() + found * width, entries.begin() + (found + 1) * width,
+                         entries.begin() + row * width);
+        negated = !negated;
+      }
+
+      const T *pivotRow = &entries[row * width];
+      auto below = rows - row - 1;
+      auto update = [&](std::size_t begin, std::size_t end) {
+        for (auto first = col + 1; first < width; first += MATRIX_BLOCK) {
+          auto last = std::min(width, first + MATRIX_BLOCK);
+          for (auto i = row + 1 + begin; i < row + 1 + end; ++i) {
+            T *target = &entries[i * width];
+            for (auto j = first; j < last; ++j) {
+              target[j] = FractionFreeUpdate(pivotRow[col], target[j], target[col], pivotRow[j],
+                                             previous);
+            }
+          }
+        }
+        for (auto i = row + 1 + begin; i < row + 1 + end; ++i) {
+          entries[i * width + col] = 0;
+        }
+      };
+      auto large = below * (width - col) >= MATRIX_PARALLEL_ENTRIES;
+      ForEachSlice(below, large ? threadCount : 1, update);
+      previous = pivotRow[col];
+      pivots.push_back(col);
+    }
+    return pivots;
   }
 
-  const Rational operator++(int) {
-    auto temp = *this;
-    *this += 1;
-    return temp;
+  std::size_t rows_;
+  std::size_t cols_;
+  std::vector<Value> values_;
+};
+
+// Arithmetic modulo an odd number p below 2^62, in Montgomery form: a
+// residue a is held as a * 2^64 mod p, so that a product takes three
+// multiplications and a shift instead of a 128-bit division. Sums and
+// differences of these representatives are the representatives of the sums
+// and differences, and 0 stands for 0.
+class Modulus {
+public:
+  explicit Modulus(std::uint64_t modulus) : modulus_(modulus) {
+    // Every odd p is its own inverse modulo 8, and each Newton step doubles
+    // the number of correct low bits.
+    std::uint64_t inverse = modulus;
+    for (int i = 0; i < 5; ++i) {
+      inverse *= 2 - modulus * inverse;
+    }
+    negatedInverse_ = std::uint64_t(0) - inverse;
+    one_ = static_cast<std::uint64_t>((UInt128(1) << 64) % modulus);
+    rSquared_ = static_cast<std::uint64_t>(UInt128(one_) * one_ % modulus);
   }
 
-  const Rational operator--(int) {
-    auto temp = *this;
-    *this -= 1;
-    return temp;
+  std::uint64_t Value() const { return modulus_; }
+  std::uint64_t One() const { return one_; }
+
+  std::uint64_t Add(std::uint64_t a, std::uint64_t b) const {
+    auto sum = a + b;
+    return sum >= modulus_ ? sum - modulus_ : sum;
   }
 
-  Rational &operator++() {
-    *this += 1;
-    return *this;
+  std::uint64_t Subtract(std::uint64_t a, std::uint64_t b) const {
+    return a >= b ? a - b : a + modulus_ - b;
   }
 
-  Rational &operator--() {
-    *this -= 1;
-    return *this;
+  std::uint64_t Multiply(std::uint64_t a, std::uint64_t b) const {
+    return Reduce(UInt128(a) * b);
   }
 
-  friend Rational operator+(Rational lhs, const Rational &rhs) {
-    return lhs += rhs;
+  std::uint64_t Power(std::uint64_t base, std::uint64_t exponent) const {
+    auto result = one_;
+    for (; exponent != 0; exponent >>= 1) {
+      if ((exponent & 1) != 0) {
+        result = Multiply(result, base);
+      }
+      base = Multiply(base, base);
+    }
+    return result;
   }
 
-  friend Rational operator-(Rational lhs, const Rational &rhs) {
-    return lhs -= rhs;
+  // By Fermat's little theorem, so only for a prime modulus and a != 0.
+  std::uint64_t Inverse(std::uint64_t a) const { return Power(a, modulus_ - 2); }
+
+  template <typename T> std::uint64_t FromInteger(const T &value) const {
+    std::uint64_t residue;
+    if constexpr (std::integral<T>) {
+      auto remainder = static_cast<Int128>(value) % static_cast<Int128>(modulus_);
+      residue = static_cast<std::uint64_t>(remainder < 0 ? remainder + modulus_ : remainder);
+    } else {
+      residue = value.Residue(modulus_);
+    }
+    return Multiply(residue, rSquared_);
   }
 
-  friend Rational operator*(Rational lhs, const Rational &rhs) {
-    return lhs *= rhs;
+  // nullopt when the modulus divides the denominator.
+  template <typename T, Normalization N>
+  std::optional<std::uint64_t> FromRational(const Rational<T, N> &value) const {
+    auto denominator = FromInteger(value.Denominator());
+    if (denominator == 0) {
+      return std::nullopt;
+    }
+    return Multiply(FromInteger(value.Numerator()), Inverse(denominator));
   }
 
-  friend Rational operator/(Rational lhs, const Rational &rhs) {
-    return lhs /= rhs;
+  // FromRational of every value with a single inversion: the prefix
+  // products of the denominators are inverted together, and the inverse of
+  // each denominator is peeled off the inverse of its prefix.
+  template <typename T, Normalization N>
+  std::optional<std::vector<std::uint64_t>>
+  FromRationals(std::span<const Rational<T, N>> values) const {
+    std::vector<std::uint64_t> residues(values.size());
+    std::vector<std::uint64_t> prefixes(values.size());
+    auto product = one_;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      prefixes[i] = product;
+      residues[i] = FromInteger(values[i].Denominator());
+      product = Multiply(product, residues[i]);
+    }
+    if (product == 0) {
+      return std::nullopt;
+    }
+    auto inverse = Inverse(product);
+    for (auto i = values.size(); i-- > 0;) {
+      auto denominator = residues[i];
+      residues[i] = Multiply(FromInteger(values[i].Numerator()), Multiply(inverse, prefixes[i]));
+      inverse = Multiply(inverse, denominator);
+    }
+    return residues;
   }
 
-  friend std::strong_ordering operator<=>(const Rational &lhs,
-                                          const Rational &rhs) {
-    return (lhs.num_ * rhs.den_) <=> (rhs.num_ * lhs.den_);
+  // The residue a stands for, in [0, p).
+  std::uint64_t ToInteger(std::uint64_t a) const { return Reduce(a); }
+
+private:
+  // value * 2^-64 mod p for value < p * 2^64.
+  std::uint64_t Reduce(UInt128 value) const {
+    auto factor = static_cast<std::uint64_t>(value) * negatedInverse_;
+    auto reduced = static_cast<std::uint64_t>((value + UInt128(factor) * modulus_) >> 64);
+    return reduced >= modulus_ ? reduced - modulus_ : reduced;
   }
 
-  friend bool operator==(const Rational &lhs, const Rational &rhs) {
-    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+  std::uint64_t modulus_;
+  std::uint64_t negatedInverse_;
+  std::uint64_t one_;
+  std::uint64_t rSquared_;
+};
+
+// Miller-Rabin with the first twelve primes as bases, which is exact below
+// 3.3 * 10^24; for odd n > 37.
+inline bool IsPrime(std::uint64_t n) {
+  Modulus modulus(n);
+  auto minusOne = modulus.Subtract(0, modulus.One());
+  auto odd = n - 1;
+  auto twos = std::countr_zero(odd);
+  odd >>= twos;
+  for (std::uint64_t base : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+    auto x = modulus.Power(modulus.FromInteger(base), odd);
+    if (x == modulus.One() || x == minusOne) {
+      continue;
+    }
+    int squarings = 1;
+    for (; squarings < twos && x != minusOne; ++squarings) {
+      x = modulus.Multiply(x, x);
+    }
+    if (x != minusOne) {
+      return false;
+    }
   }
+  return true;
+}
 
-  friend std::istream &operator>>(std::istream &stream, Rational &rational) {
-    char slash = 0;
-    stream >> rational.num_ >> slash >> rational.den_;
-    rational.Reduce();
-    return stream;
+// The count largest primes below MODULAR_PRIME_LIMIT, in decreasing order.
+// They are searched for once and shared by all threads.
+inline std::vector<std::uint64_t> ModularPrimes(std::size_t count) {
+  static std::mutex mutex;
+  static std::vector<std::uint64_t> primes;
+  std::lock_guard lock(mutex);
+  auto candidate = primes.empty() ? MODULAR_PRIME_LIMIT - 1 : primes.back() - 2;
+  for (; primes.size() < count; candidate -= 2) {
+    if (IsPrime(candidate)) {
+      primes.push_back(candidate);
+    }
   }
+  return {primes.begin(), primes.begin() + static_cast<std::ptrdiff_t>(count)};
+}
 
-  friend std::ostream &operator<<(std::ostream &stream,
-                                  const Rational &rational) {
-    return stream << rational.num_ << '/' << rational.den_;
+// floor(sqrt(value)) for value >= 0, by Newton's iteration from a power of
+// two above the root, which decreases until it reaches it.
+inline BigInt SquareRoot(const BigInt &value) {
+  if (value == 0) {
+    return value;
   }
+  BigInt root(1);
+  for (auto bits = (value.BitWidth() + 1) / 2; bits > 0;) {
+    auto step = std::min<std::size_t>(bits, 62);
+    root *= BigInt(1LL << step);
+    bits -= step;
+  }
+  while (true) {
+    auto next = (root + value / root) / 2;
+    if (next >= root) {
+      return root;
+    }
+    root = std::move(next);
+  }
+}
 
-private:
-  void Reduce() {
-    if (den_ < 0) {
-      num_ = -num_;
-      den_ = -den_;
+// A pair (a, b) with |a|, b <= bound and a == value * b modulo modulus, if
+// there is one, for 2 * bound^2 < modulus, which makes a / b unique. The
+// extended Euclidean algorithm on (modulus, value) is stopped at the first
+// remainder within the bound (Wang's rational reconstruction). Wang's check
+// that gcd(a, b) == 1 takes a full GCD and is left to the caller, who must
+// verify the fraction anyway and reduces it only once accepted. Far from the
+// bound it runs in the Lehmer steps of BigInt::LehmerStep, which apply the
+// combined matrix of many quotients to the full numbers at once.
+inline std::optional<std::pair<BigInt, BigInt>> ReconstructRational(const BigInt &value,
+                                                                    const BigInt &modulus,
+                                                                    const BigInt &bound) {
+  BigInt remainder = modulus;
+  BigInt next = value;
+  BigInt coefficient(0);
+  BigInt nextCoefficient(1);
+  while (next > bound) {
+    if (next.BitWidth() > bound.BitWidth() + 128) {
+      if (auto step = BigInt::LehmerStep(remainder, next)) {
+        auto [a, b, c, d] = *step;
+        auto combine = [&](BigInt &first, BigInt &second) {
+          auto combined = first * BigInt(a) + second * BigInt(b);
+          second = first * BigInt(c) + second * BigInt(d);
+          first = std::move(combined);
+        };
+        combine(remainder, next);
+        combine(coefficient, nextCoefficient);
+        continue;
+      }
     }
-    auto common = std::gcd(num_, den_);
-    num_ /= common;
-    den_ /= common;
+    auto quotient = remainder / next;
+    remainder = std::exchange(next, remainder - quotient * next);
+    coefficient = std::exchange(nextCoefficient, coefficient - quotient * nextCoefficient);
+  }
+  auto magnitude = nextCoefficient.IsNegative() ? -nextCoefficient : nextCoefficient;
+  if (magnitude == 0 || magnitude > bound) {
+    return std::nullopt;
   }
+  return std::pair(nextCoefficient.IsNegative() ? -next : next, std::move(magnitude));
+}
 
-  T num_ = 0;
-  T den_ = 1;
-};
+// Exact results of a computation over the rationals that can be carried
+// out modulo a prime instead. compute(modulus) returns the results modulo
+// modulus.Value() in [0, p), or nullopt for an unlucky prime, such as one
+// that divides a denominator or makes a pivot vanish. Batches of primes run
+// in parallel on up to threadCount threads and their results are combined
+// by the Chinese remainder theorem in Garner's incremental form. After each
+// batch every result is reconstructed as a fraction, and the candidates are
+// returned once the next batch agrees with them: a wrong candidate would
+// have to match all of its primes by chance, and only then are they brought
+// to lowest terms. Entries rarely need a Euclidean reconstruction of their
+// own, since the denominator of an earlier one usually fits them too. Throws
+// std::domain_error when a whole batch of primes is unlucky and
+// std::overflow_error when the results need more than
+// MULTIMODULAR_MAX_PRIMES primes.
+template <typename Compute>
+std::vector<Rational<BigInt>> MultiModular(Compute compute, std::size_t threadCount = 1) {
+  std::vector<BigInt> images;
+  BigInt product(1);
+  std::optional<std::vector<std::pair<BigInt, BigInt>>> candidates;
+  for (std::size_t used = 0, batch = 0;; used += batch) {
+    batch = std::max({threadCount, MULTIMODULAR_BATCH, used / 4});
+    if (used + batch > MULTIMODULAR_MAX_PRIMES) {
+      throw std::overflow_error("MultiModular: results need too many primes");
+    }
+    auto primes = ModularPrimes(used + batch);
+    std::vector<std::optional<std::vector<std::uint64_t>>> residues(batch);
+    ForEachSlice(batch, threadCount, [&](std::size_t begin, std::size_t end) {
+      for (auto i = begin; i < end; ++i) {
+        residues[i] = compute(Modulus(primes[used + i]));
+      }
+    });
+
+    bool lucky = false;
+    bool confirmed = candidates.has_value();
+    for (std::size_t i = 0; i < batch; ++i) {
+      if (!residues[i]) {
+        continue;
+      }
+      lucky = true;
+      if (!confirmed) {
+        continue;
+      }
+      Modulus modulus(primes[used + i]);
+      for (std::size_t j = 0; confirmed && j < residues[i]->size(); ++j) {
+        const auto &[numerator, denominator] = (*candidates)[j];
+        auto scale = modulus.FromInteger(denominator);
+        auto image = modulus.FromInteger((*residues[i])[j]);
+        confirmed = scale != 0 && modulus.FromInteger(numerator) == modulus.Multiply(image, scale);
+      }
+    }
+    if (!lucky) {
+      throw std::domain_error("MultiModular: computation fails modulo every prime");
+    }
+    if (confirmed) {
+      std::vector<Rational<BigInt>> results(candidates->size());
+      ForEachSlice(results.size(), threadCount, [&](std::size_t begin, std::size_t end) {
+        for (auto j = begin; j < end; ++j) {
+          results[j] = Rational<BigInt>((*candidates)[j].first, (*candidates)[j].second);
+        }
+      });
+      return results;
+    }
+
+    for (std::size_t i = 0; i < batch; ++i) {
+      if (!residues[i]) {
+        continue;
+      }
+      const auto &current = *residues[i];
+      Modulus modulus(primes[used + i]);
+      if (images.empty()) {
+        images.resize(current.size());
+      }
+      auto inverse = modulus.Inverse(modulus.FromInteger(product));
+      ForEachSlice(images.size(), threadCount, [&](std::size_t begin, std::size_t end) {
+        for (auto j = begin; j < end; ++j) {
+          auto difference =
+              modulus.Subtract(modulus.FromInteger(current[j]), modulus.FromInteger(images[j]));
+          auto digit = modulus.ToInteger(modulus.Multiply(difference, inverse));
+          images[j] += product * BigInt(static_cast<long long>(digit));
+        }
+      });
+      product *= BigInt(static_cast<long long>(modulus.Value()));
+    }
+
+    auto bound = SquareRoot(product / 2);
+    auto half = product / 2;
+    BigInt denominator(1);
+    candidates.emplace();
+    for (const auto &image : images) {
+      if (denominator <= bound) {
+        auto scaled = image * denominator % product;
+        if (scaled > half) {
+          scaled -= product;
+        }
+        if ((scaled.IsNegative() ? -scaled : scaled) <= bound) {
+          candidates->emplace_back(std::move(scaled), denominator);
+          continue;
+        }
+      }
+      auto fraction = ReconstructRational(image, product, bound);
+      if (!fraction) {
+        candidates.reset();
+        break;
+      }
+      denominator = fraction->second;
+      candidates->push_back(std::move(*fraction));
+    }
+  }
+}
+
+// sum lhs[i] * rhs[i], computed modulo primes by MultiModular. Throws
+// std::invalid_argument when the sizes differ.
+template <typename T>
+Rational<BigInt> ModularDot(const std::vector<Rational<T>> &lhs,
+                            const std::vector<Rational<T>> &rhs, std::size_t threadCount = 1) {
+  if (lhs.size() != rhs.size()) {
+    throw std::invalid_argument("ModularDot: sizes differ");
+  }
+  auto results = MultiModular(
+      [&](const Modulus &modulus) -> std::optional<std::vector<std::uint64_t>> {
+        auto left = modulus.FromRationals(std::span(lhs));
+        auto right = modulus.FromRationals(std::span(rhs));
+        if (!left || !right) {
+          return std::nullopt;
+        }
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+          sum = modulus.Add(sum, modulus.Multiply((*left)[i], (*right)[i]));
+        }
+        return std::vector{modulus.ToInteger(sum)};
+      },
+      threadCount);
+  return results.front();
+}
+
+// sum coefficients[i] * x^i by Horner's rule modulo primes.
+template <typename T>
+Rational<BigInt> ModularPolynomial(const std::vector<Rational<T>> &coefficients,
+                                   const Rational<T> &x, std::size_t threadCount = 1) {
+  auto results = MultiModular(
+      [&](const Modulus &modulus) -> std::optional<std::vector<std::uint64_t>> {
+        auto residues = modulus.FromRationals(std::span(coefficients));
+        auto point = modulus.FromRational(x);
+        if (!residues || !point) {
+          return std::nullopt;
+        }
+        std::uint64_t value = 0;
+        for (auto coefficient = residues->rbegin(); coefficient != residues->rend();
+             ++coefficient) {
+          value = modulus.Add(modulus.Multiply(value, *point), *coefficient);
+        }
+        return std::vector{modulus.ToInteger(value)};
+      },
+      threadCount);
+  return results.front();
+}
+
+// The X with matrix * X == rhs, like RationalMatrix::Solve, by Gaussian
+// elimination modulo primes. A prime that divides the determinant is
+// unlucky, so a singular matrix makes every prime fail and throws
+// std::domain_error; std::invalid_argument means the shapes do not fit.
+template <typename T>
+RationalMatrix<BigInt> ModularSolve(const RationalMatrix<T> &matrix, const RationalMatrix<T> &rhs,
+                                    std::size_t threadCount = 1) {
+  if (matrix.Rows() != matrix.Cols() || rhs.Rows() != matrix.Rows()) {
+    throw std::invalid_argument("ModularSolve: shapes do not match");
+  }
+  auto size = matrix.Rows();
+  auto width = size + rhs.Cols();
+  std::vector<Rational<T>> augmented;
+  augmented.reserve(size * width);
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      augmented.push_back(matrix(i, j));
+    }
+    for (std::size_t j = 0; j < rhs.Cols(); ++j) {
+      augmented.push_back(rhs(i, j));
+    }
+  }
+
+  auto solution = MultiModular(
+      [&](const Modulus &modulus) -> std::optional<std::vector<std::uint64_t>> {
+        auto converted = modulus.FromRationals(std::span<const Rational<T>>(augmented));
+        if (!converted) {
+          return std::nullopt;
+        }
+        auto &entries = *converted;
+        for (std::size_t col = 0; col < size; ++col) {
+          auto found = col;
+          while (found < size && entries[found * width + col] == 0) {
+            ++found;
+          }
+          if (found == size) {
+            return std::nullopt;
+          }
+          std::swap_ranges(entries.begin() + found * width, entries.begin() + (found + 1) * width,
+                           entries.begin() + col * width);
+          auto *pivotRow = &entries[col * width];
+          auto inverse = modulus.Inverse(pivotRow[col]);
+          for (auto j = col; j < width; ++j) {
+            pivotRow[j] = modulus.Multiply(pivotRow[j], inverse);
+          }
+          for (auto i = col + 1; i < size; ++i) {
+            auto *target = &entries[i * width];
+            auto factor = target[col];
+            for (auto j = col + 1; factor != 0 && j < width; ++j) {
+              target[j] = modulus.Subtract(target[j], modulus.Multiply(factor, pivotRow[j]));
+            }
+          }
+        }
+        // The rows are now unit upper triangular; clearing the columns from
+        // the last one up leaves X in the right-hand columns.
+        for (auto col = size; col-- > 0;) {
+          const auto *pivotRow = &entries[col * width];
+          for (std::size_t i = 0; i < col; ++i) {
+            auto *target = &entries[i * width];
+            auto factor = target[col];
+            for (auto j = size; factor != 0 && j < width; ++j) {
+              target[j] = modulus.Subtract(target[j], modulus.Multiply(factor, pivotRow[j]));
+            }
+          }
+        }
+        std::vector<std::uint64_t> results;
+        results.reserve(size * rhs.Cols());
+        for (std::size_t i = 0; i < size; ++i) {
+          for (auto j = size; j < width; ++j) {
+            results.push_back(modulus.ToInteger(entries[i * width + j]));
+          }
+        }
+        return results;
+      },
+      threadCount);
+  return RationalMatrix<BigInt>(size, rhs.Cols(), std::move(solution));
+}
 
 bool AreDoublesEqual(double x, double y) {
   return std::abs(x - y) < EPSILON_VAL;
@@ -181,9 +2046,798 @@ void TestIO() {
   assert(r2 == RationalInt(5, 2));
 }
 
-int main() {
+void TestOverflow() {
+  using RationalInt = Rational<int>;
+  const int big = 1 << 20;
+
+  // Cross-cancelling keeps every intermediate small.
+  assert(RationalInt(big, 3) * RationalInt(3, big) == RationalInt(1));
+  assert(RationalInt(big, 7) * RationalInt(14, big + 1) == RationalInt(2 * big, big + 1));
+
+  // The sums fit although the numerator before reduction does not.
+  const int max = std::numeric_limits<int>::max();
+  assert(RationalInt(max, 2) + RationalInt(max, 2) == RationalInt(max));
+  assert(RationalInt(max, 6) + RationalInt(max, 3) == RationalInt(max, 2));
+  assert(RationalInt(max, 2) - RationalInt(max, 2) == RationalInt(0));
+
+  assert(RationalInt(max, big) > RationalInt(max - 1, big));
+  assert(RationalInt(big + 1, big) < RationalInt(big, big - 1));
+
+  using RationalLL = Rational<long long>;
+  const long long huge = 1LL << 40;
+  assert(RationalLL(huge + 1, huge) < RationalLL(huge, huge - 1));
+  assert(RationalLL(huge, 3) * RationalLL(9, huge) == RationalLL(3));
+  const long long maxLL = std::numeric_limits<long long>::max();
+  assert(RationalLL(maxLL, 2) + RationalLL(maxLL, 2) == RationalLL(maxLL));
+  assert(RationalLL(maxLL, maxLL - 1) < RationalLL(maxLL - 1, maxLL - 2));
+
+  auto overflows = [](auto operation) {
+    try {
+      operation();
+    } catch (const std::overflow_error &) {
+      return true;
+    }
+    return false;
+  };
+  assert(overflows([&] { return RationalLL(huge, 3) * RationalLL(huge, 5); }));
+  assert(overflows([&] { return RationalInt(max) + RationalInt(max); }));
+}
+
+void TestBinaryGcd() {
+  assert(Gcd(0, 0) == 0);
+  assert(Gcd(0, 12) == 12 && Gcd(-12, 0) == 12);
+  assert(Gcd(48, 18) == 6 && Gcd(-48, 18) == 6 && Gcd(48, -18) == 6);
+  assert(Gcd(1LL << 40, 3LL << 20) == 1LL << 20);
+  for (int a = -50; a <= 50; ++a) {
+    for (int b = -50; b <= 50; ++b) {
+      assert(Gcd(a, b) == std::gcd(a, b));
+    }
+  }
+
+  using RationalInt = Rational<int>;
+  assert(RationalInt(7, 12) + RationalInt(5, 12) == RationalInt(1));
+  assert(RationalInt(3, 10) - RationalInt(3, 10) == RationalInt(0));
+  assert(RationalInt(-5, 8) + RationalInt(1, 24) == RationalInt(-7, 12));
+}
+
+void TestLazy() {
+  using Lazy = Rational<int, Normalization::Lazy>;
+  Lazy half(2, 4);
+  assert(half == Lazy(1, 2));
+  assert(half + half == Lazy(1));
+  assert(half * Lazy(-4, 6) < Lazy(0));
+
+  std::stringstream ss;
+  ss << half * half + Lazy(1, 4);
+  assert(ss.str() == "1/2");
+
+  // The unreduced sums overflow long before the reduced ones do, so this
+  // keeps falling back to the reducing path.
+  using LazyLL = Rational<long long, Normalization::Lazy>;
+  LazyLL lazy;
+  Rational<long long> eager;
+  for (int i = 1; i <= 40; ++i) {
+    lazy += LazyLL(1, i);
+    eager += Rational<long long>(1, i);
+  }
+  std::stringstream lazyText;
+  std::stringstream eagerText;
+  lazyText << lazy;
+  eagerText << eager;
+  assert(lazyText.str() == eagerText.str());
+
+  // BigInt never overflows, so only the size trigger keeps the harmonic sum
+  // from carrying 500! as its denominator.
+  using LazyBig = Rational<BigInt, Normalization::Lazy>;
+  LazyBig lazyBig;
+  Rational<BigInt> eagerBig;
+  for (int i = 1; i <= 500; ++i) {
+    lazyBig += LazyBig(1, i);
+    eagerBig += Rational<BigInt>(1, i);
+    assert(lazyBig.Denominator().BitWidth() <= LAZY_REDUCE_BITS);
+  }
+  lazyBig.Normalize();
+  assert(lazyBig.Numerator() == eagerBig.Numerator() &&
+         lazyBig.Denominator() == eagerBig.Denominator());
+  lazy.Normalize();
+  assert(AreDoublesEqual(static_cast<double>(lazy), static_cast<double>(eager)));
+}
+
+void TestBigInt() {
+  const long long maxLL = std::numeric_limits<long long>::max();
+  BigInt a = maxLL;
+  assert(a.IsInline());
+  a += 1;
+  assert(!a.IsInline());
+  a -= 1;
+  assert(a.IsInline() && a == maxLL);
+  assert(!(-BigInt(std::numeric_limits<long long>::min())).IsInline());
+
+  BigInt power(1);
+  for (int i = 0; i < 200; ++i) {
+    power *= 2;
+  }
+  BigInt three(1);
+  for (int i = 0; i < 100; ++i) {
+    three *= 3;
+  }
+  auto product = (power + 1) * three;
+  assert(product / three == power + 1);
+  assert(product % three == 0);
+  assert((product + 5) % three == 5);
+  assert(-product / three == -(power + 1));
+  assert((-product - 5) % three == -5);
+  assert(Gcd(product, power * 3) == 3);
+  assert(Gcd(-power, power * 7) == power);
+
+  assert(power > three && -power < -three && -power < 0);
+  assert(BigInt(-1) < power);
+
+  std::stringstream ss;
+  ss << power;
+  assert(ss.str() == "1606938044258990275541962092341162602522202993782792835301376");
+  BigInt parsed;
+  ss >> parsed;
+  assert(parsed == power);
+  assert(BigInt("-" + ss.str()) == -power);
+  assert(AreDoublesEqual(static_cast<double>(power) / std::ldexp(1.0, 200), 1.0));
+
+  auto throws = [](auto operation, auto error) {
+    try {
+      operation();
+    } catch (const decltype(error) &) {
+      return true;
+    }
+    return false;
+  };
+  for (const BigInt &dividend : {BigInt(7), power}) {
+    assert(throws([&] { return dividend / BigInt(0); }, std::domain_error("")));
+    assert(throws([&] { return dividend % BigInt(0); }, std::domain_error("")));
+  }
+  for (auto text : {"12a", "", "-", "1 2", "+-3"}) {
+    assert(throws([&] { return BigInt(text); }, std::invalid_argument("")));
+  }
+
+  // Long operands go through Lehmer steps; plain Euclid is the reference.
+  auto common = three * (power + 7);
+  auto lhs = common * (power * power + 1);
+  auto rhs = common * (three * three * three + 2);
+  auto x = lhs;
+  auto y = rhs;
+  while (y != 0) {
+    x = std::exchange(y, x % y);
+  }
+  assert(Gcd(lhs, rhs) == x && Gcd(rhs, -lhs) == x);
+  assert(Gcd(lhs, rhs) % common == 0);
+}
+
+void TestBigRational() {
+  using RationalBig = Rational<BigInt>;
+  RationalBig sum;
+  for (int i = 1; i <= 60; ++i) {
+    sum += RationalBig(1, i);
+  }
+  double harmonic = 0;
+  for (int i = 1; i <= 60; ++i) {
+    harmonic += 1.0 / i;
+  }
+  assert(AreDoublesEqual(static_cast<double>(sum), harmonic));
+  for (int i = 60; i >= 1; --i) {
+    sum -= RationalBig(1, i);
+  }
+  assert(sum == RationalBig(0));
+
+  BigInt power(1);
+  for (int i = 0; i < 100; ++i) {
+    power *= 2;
+  }
+  assert(RationalBig(power, power / 4) == RationalBig(4));
+  assert(RationalBig(power + 1, power) < RationalBig(power, power - 1));
+  // The double approximations of these tie, so the products decide.
+  assert(RationalBig(power + 2, power + 1) < RationalBig(power + 1, power));
+  assert(RationalBig(power * power, 3) > RationalBig(power, 7));
+  assert(RationalBig(power, 3) * RationalBig(9, power) == RationalBig(3));
+  assert(++RationalBig(power, 2) == RationalBig(power / 2 + 1));
+
+  // 2^1100 overflows a double while 2^1000 + 1 does not, so the quotient
+  // approximates (2^1000 + 1) / 2^1100, about 2^-100, by 0.
+  BigInt huge(1);
+  for (int i = 0; i < 1100; ++i) {
+    huge *= 2;
+  }
+  BigInt large = huge / power + 1;
+  BigInt tiny = power * power;
+  assert(RationalBig(large, huge) > RationalBig(1, tiny));
+  assert(RationalBig(1, tiny) < RationalBig(large, huge));
+  assert(RationalBig(-large, huge) < RationalBig(-1, tiny));
+
+  std::stringstream ss;
+  ss << RationalBig(power, 3);
+  RationalBig parsed;
+  ss >> parsed;
+  assert(parsed == RationalBig(power, 3));
+}
+
+void TestHash() {
+  using RationalInt = Rational<int>;
+  using Lazy = Rational<int, Normalization::Lazy>;
+  std::hash<RationalInt> hashInt;
+  assert(hashInt(RationalInt(2, 4)) == hashInt(RationalInt(-3, -6)));
+  assert(hashInt(RationalInt(1, 2)) != hashInt(RationalInt(2, 1)));
+  std::hash<Lazy> hashLazy;
+  assert(hashLazy(Lazy(2, 4)) == hashLazy(Lazy(1, 2)));
+  assert(hashLazy(Lazy(1, 3) + Lazy(1, 6)) == hashLazy(Lazy(1, 2)));
+
+  // Random inserts and erases on a small key range, so that clusters form
+  // and erasing shifts them, checked against std::map.
+  std::mt19937 generator(7);
+  FlatHashMap<RationalInt, int> map;
+  std::map<RationalInt, int> reference;
+  for (int i = 0; i < 20000; ++i) {
+    RationalInt key(static_cast<int>(generator() % 41) - 20,
+                    static_cast<int>(generator() % 20) + 1);
+    switch (generator() % 3) {
+    case 0:
+      map[key] += i;
+      reference[key] += i;
+      break;
+    case 1:
+      assert(map.Erase(key) == (reference.erase(key) == 1));
+      break;
+    default: {
+      auto *found = map.Find(key);
+      auto expected = reference.find(key);
+      assert((found == nullptr) == (expected == reference.end()));
+      assert(found == nullptr || *found == expected->second);
+    }
+    }
+    assert(map.Size() == reference.size());
+  }
+  std::size_t visited = 0;
+  map.ForEach([&](const RationalInt &key, int value) {
+    assert(reference.at(key) == value);
+    ++visited;
+  });
+  assert(visited == reference.size());
+
+  FlatHashSet<Rational<long long>> set;
+  for (long long i = 1; i <= 1000; ++i) {
+    assert(set.Insert(Rational<long long>(i, 1)));
+    assert(!set.Insert(Rational<long long>(2 * i, 2)));
+  }
+  assert(set.Size() == 1000 && set.Contains(Rational<long long>(500)));
+  assert(!set.Contains(Rational<long long>(1, 2)));
+
+  // std::hash leaves small integers unchanged, all with zero high bits; only
+  // the mixing keeps sequential keys from piling up in one cluster.
+  FlatHashMap<long long, int> integers;
+  for (int i = 0; i < 200000; ++i) {
+    integers[i] = i;
+  }
+  for (int i = 0; i < 200000; i += 7) {
+    assert(integers.Erase(i));
+  }
+  for (int i = 0; i < 200000; ++i) {
+    auto *found = integers.Find(i);
+    assert(i % 7 == 0 ? found == nullptr : found != nullptr && *found == i);
+  }
+}
+
+void TestDoubleConversion() {
+  // Converting both sides first rounds twice and is one ulp off here.
+  Rational<long long> close(7018639715332314491, 2177846766610798755);
+  assert(static_cast<double>(close) == 3.2227426754430653);
+  assert(static_cast<double>(Rational<long long>(-7018639715332314491, 2177846766610798755)) ==
+         -3.2227426754430653);
+  assert(static_cast<double>(Rational<long long>((1LL << 53) + 1)) == 0x1p53);
+  assert(static_cast<double>(Rational<long long>((1LL << 53) + 3)) == 0x1p53 + 4);
+  assert(static_cast<double>(Rational<long long>(1, 3)) == 1.0 / 3);
+  // Lazy values keep 0 over a large denominator, which the 128-bit
+  // quotient cannot take.
+  using RationalLazy = Rational<long long, Normalization::Lazy>;
+  assert(static_cast<double>(RationalLazy(0, 1LL << 60)) == 0.0);
+  RationalLazy unreduced(3, (1LL << 58) + 1);
+  assert(static_cast<double>(unreduced - unreduced) == 0.0);
+
+  using RationalInt = Rational<int>;
+  assert(RationalInt::FromDouble(0.5) == RationalInt(1, 2));
+  assert(RationalInt::FromDouble(-0.75) == RationalInt(-3, 4));
+  assert(RationalInt::FromDouble(0.1) == RationalInt(1, 10));
+  assert(RationalInt::FromDouble(M_PI, 100) == RationalInt(311, 99));
+  assert(RationalInt::FromDouble(M_PI, 1000) == RationalInt(355, 113));
+  assert(RationalInt::FromDouble(-1.0 / 3, 2) == RationalInt(-1, 2));
+  assert(RationalInt::FromDouble(1e-30) == RationalInt(0));
+  assert(RationalInt::FromDouble(2147483647.2) == RationalInt(2147483647));
+  assert(RationalInt::FromDouble(2147483647.7) == RationalInt(2147483647));
+  assert(Rational<long long>::FromDouble(1e18) == Rational<long long>(1000000000000000000LL));
+  assert(Rational<long long>::FromDouble(0.1, 1000000) == Rational<long long>(1, 10));
+
+  auto throws = [](auto convert, auto expected) {
+    try {
+      convert();
+    } catch (const decltype(expected) &) {
+      return true;
+    }
+    return false;
+  };
+  assert(throws([] { RationalInt::FromDouble(3e9); }, std::overflow_error("")));
+  assert(throws([] { RationalInt::FromDouble(std::nan("")); }, std::invalid_argument("")));
+  assert(throws([] { RationalInt::FromDouble(0.5, 0); }, std::invalid_argument("")));
+
+  // Against every denominator up to the bound: nothing is closer, and ties
+  // go to the smaller denominator.
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> distribution(-4, 4);
+  for (int i = 0; i < 2000; ++i) {
+    auto x = distribution(generator);
+    int maxDen = static_cast<int>(generator() % 60) + 1;
+    auto best = RationalInt::FromDouble(x, maxDen);
+    auto error = [&](long double num, long double den) {
+      return std::abs(static_cast<long double>(x) - num / den);
+    };
+    auto bestError = error(best.Numerator(), best.Denominator());
+    for (int den = 1; den <= maxDen; ++den) {
+      assert(bestError <= error(std::round(x * den), den));
+    }
+  }
+}
+
+// Gauss-Jordan elimination over Rational<T> itself, which reduces after
+// every operation; the reference RationalMatrix::Solve is checked and
+// measured against.
+template <typename T>
+RationalMatrix<T> GaussianSolve(RationalMatrix<T> matrix, RationalMatrix<T> rhs) {
+  auto size = matrix.Rows();
+  for (std::size_t col = 0; col < size; ++col) {
+    auto pivot = col;
+    while (matrix(pivot, col) == Rational<T>(0)) {
+      ++pivot;
+    }
+    for (std::size_t j = 0; j < size; ++j) {
+      std::swap(matrix(pivot, j), matrix(col, j));
+    }
+    for (std::size_t j = 0; j < rhs.Cols(); ++j) {
+      std::swap(rhs(pivot, j), rhs(col, j));
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      if (i == col || matrix(i, col) == Rational<T>(0)) {
+        continue;
+      }
+      auto factor = matrix(i, col) / matrix(col, col);
+      for (std::size_t j = col; j < size; ++j) {
+        matrix(i, j) -= factor * matrix(col, j);
+      }
+      for (std::size_t j = 0; j < rhs.Cols(); ++j) {
+        rhs(i, j) -= factor * rhs(col, j);
+      }
+    }
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < rhs.Cols(); ++j) {
+      rhs(i, j) /= matrix(i, i);
+    }
+  }
+  return rhs;
+}
+
+// Entries with numerators below range in magnitude and denominators up to 16.
+template <typename T>
+RationalMatrix<T> RandomMatrix(std::size_t rows, std::size_t cols, int range,
+                               std::mt19937 &generator) {
+  RationalMatrix<T> matrix(rows, cols);
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t j = 0; j < cols; ++j) {
+      matrix(i, j) = Rational<T>(static_cast<int>(generator() % (2 * range + 1)) - range,
+                                 static_cast<int>(generator() % 16) + 1);
+    }
+  }
+  return matrix;
+}
+
+void TestMatrix() {
+  using Matrix = RationalMatrix<BigInt>;
+  using Value = Matrix::Value;
+
+  // det of the n x n Hilbert matrix is 1 / 6048000 for n = 4.
+  Matrix hilbert(4, 4);
+  for (std::size_t i = 0; i < 4; ++i) {
+    for (std::size_t j = 0; j < 4; ++j) {
+      hilbert(i, j) = Value(1, static_cast<long long>(i + j + 1));
+    }
+  }
+  assert(hilbert.Determinant() == Value(1, 6048000));
+  assert(hilbert * hilbert.Inverse() == Matrix::Identity(4));
+  assert(hilbert.Inverse()(3, 3) == Value(2800));
+
+  Matrix swapped(2, 2, {Value(0), Value(1), Value(1), Value(0)});
+  assert(swapped.Determinant() == Value(-1));
+
+  // The third row is the sum of the others.
+  Matrix singular(3, 3, {Value(1, 2), Value(1), Value(2), Value(0), Value(3), Value(-1, 3),
+                         Value(1, 2), Value(4), Value(5, 3)});
+  assert(singular.Rank() == 2 && singular.Determinant() == Value(0));
+  bool threw = false;
+  try {
+    singular.Inverse();
+  } catch (const std::domain_error &) {
+    threw = true;
+  }
+  assert(threw);
+  assert(Matrix(2, 3).Rank() == 0);
+  assert(Matrix(0, 0).Determinant() == Value(1) && Matrix(0, 0).Rank() == 0);
+  assert(Matrix(0, 0).Solve(Matrix(0, 3)) == Matrix(0, 3));
+  assert(Matrix(0, 0).Inverse() == Matrix(0, 0));
+  assert(Matrix(3, 5, {Value(0), Value(1), Value(2), Value(3), Value(4),
+                       Value(0), Value(2), Value(4), Value(6), Value(8),
+                       Value(0), Value(0), Value(0), Value(1), Value(1)}).Rank() == 2);
+
+  std::mt19937 generator(5);
+  for (std::size_t size : {1, 2, 5, 12}) {
+    auto matrix = RandomMatrix<BigInt>(size, size, 50, generator);
+    auto rhs = RandomMatrix<BigInt>(size, 3, 50, generator);
+    auto solution = matrix.Solve(rhs);
+    assert(solution == GaussianSolve(matrix, rhs));
+    assert(matrix * solution == rhs);
+    assert(matrix.Solve(rhs, 4) == solution);
+    assert(matrix.Determinant(4) == matrix.Determinant());
+  }
+
+  // Large enough for the elimination steps to be split among threads.
+  auto large = RandomMatrix<BigInt>(80, 80, 5, generator);
+  auto column = RandomMatrix<BigInt>(80, 1, 5, generator);
+  auto solution = large.Solve(column, 4);
+  assert(large * solution == column && solution == large.Solve(column));
+
+  // Fixed-width entries work while the minors fit, and overflow loudly.
+  RationalMatrix<long long> small(2, 2, {Rational<long long>(2, 3), Rational<long long>(1),
+                                         Rational<long long>(5), Rational<long long>(-1, 4)});
+  assert(small.Determinant() == Rational<long long>(-31, 6));
+  auto wide = RandomMatrix<long long>(30, 30, 1000, generator);
+  threw = false;
+  try {
+    wide.Determinant();
+  } catch (const std::overflow_error &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+void TestMultiModular() {
+  using Value = Rational<BigInt>;
+  auto primes = ModularPrimes(4);
+  assert(primes[0] == MODULAR_PRIME_LIMIT - 57 && primes[3] == MODULAR_PRIME_LIMIT - 143);
+
+  Modulus modulus(primes[0]);
+  std::mt19937_64 random(9);
+  for (int i = 0; i < 1000; ++i) {
+    auto a = random() % primes[0];
+    auto b = random() % primes[0];
+    auto product = modulus.Multiply(modulus.FromInteger(a), modulus.FromInteger(b));
+    assert(modulus.ToInteger(product) == static_cast<std::uint64_t>(UInt128(a) * b % primes[0]));
+    if (a != 0) {
+      auto residue = modulus.FromInteger(a);
+      assert(modulus.Multiply(residue, modulus.Inverse(residue)) == modulus.One());
+    }
+  }
+  assert(modulus.ToInteger(modulus.FromInteger(-1)) == primes[0] - 1);
+  BigInt big("-123456789012345678901234567890123456789");
+  BigInt prime(static_cast<long long>(primes[0]));
+  auto expected = big % prime + prime;
+  assert(BigInt(static_cast<long long>(modulus.ToInteger(modulus.FromInteger(big)))) == expected);
+  assert(!modulus.FromRational(Rational<long long>(1, static_cast<long long>(primes[0]))));
+
+  BigInt power("100000000000000000000");
+  assert(SquareRoot(power * power) == power);
+  assert(SquareRoot(power * power - 1) == power - 1);
+  assert(SquareRoot(BigInt(2)) == 1);
+
+  std::mt19937 generator(11);
+  auto randomValues = [&](std::size_t count, const BigInt &scale) {
+    std::vector<Value> values;
+    for (std::size_t i = 0; i < count; ++i) {
+      values.emplace_back(BigInt(static_cast<long long>(generator() % 2001) - 1000) * scale,
+                          static_cast<long long>(generator() % 1000) + 1);
+    }
+    return values;
+  };
+  for (const auto &scale : {BigInt(1), power * power}) {
+    auto lhs = randomValues(60, scale);
+    auto rhs = randomValues(60, 1);
+    Value dot;
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+      dot += lhs[i] * rhs[i];
+    }
+    assert(ModularDot(lhs, rhs) == dot && ModularDot(lhs, rhs, 4) == dot);
+
+    Value x(-7, 3);
+    Value value;
+    for (auto coefficient = lhs.rbegin(); coefficient != lhs.rend(); ++coefficient) {
+      value = value * x + *coefficient;
+    }
+    assert(ModularPolynomial(lhs, x) == value && ModularPolynomial(lhs, x, 3) == value);
+  }
+  assert(ModularDot(std::vector{Value(1, 2), Value(-1, 2)}, std::vector{Value(1), Value(1)}) ==
+         Value(0));
+  assert(ModularPolynomial(std::vector<Value>{}, Value(5)) == Value(0));
+
+  // The first prime divides a denominator and is skipped.
+  std::vector unlucky{Rational<long long>(1, static_cast<long long>(primes[0])),
+                      Rational<long long>(1, 3)};
+  assert(ModularDot(unlucky, std::vector{Rational<long long>(1), Rational<long long>(1)}) ==
+         Value(prime + 3, prime * 3));
+  bool threw = false;
+  try {
+    ModularDot(unlucky, std::vector{Rational<long long>(1)});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+
+  using Matrix = RationalMatrix<BigInt>;
+  Matrix hilbert(8, 8);
+  for (std::size_t i = 0; i < 8; ++i) {
+    for (std::size_t j = 0; j < 8; ++j) {
+      hilbert(i, j) = Value(1, static_cast<long long>(i + j + 1));
+    }
+  }
+  assert(ModularSolve(hilbert, Matrix::Identity(8)) == hilbert.Inverse());
+  for (std::size_t size : {1, 5, 20}) {
+    auto matrix = RandomMatrix<BigInt>(size, size, 1000, generator);
+    auto rhs = RandomMatrix<BigInt>(size, 3, 1000, generator);
+    auto solution = matrix.Solve(rhs);
+    assert(ModularSolve(matrix, rhs) == solution && ModularSolve(matrix, rhs, 4) == solution);
+  }
+  auto small = RandomMatrix<long long>(4, 4, 10, generator);
+  auto column = RandomMatrix<long long>(4, 1, 10, generator);
+  auto widened = [](const Rational<long long> &value) {
+    return Value(value.Numerator(), value.Denominator());
+  };
+  auto smallSolution = ModularSolve(small, column);
+  for (std::size_t i = 0; i < 4; ++i) {
+    Value sum;
+    for (std::size_t j = 0; j < 4; ++j) {
+      sum += widened(small(i, j)) * smallSolution(j, 0);
+    }
+    assert(sum == widened(column(i, 0)));
+  }
+
+  Matrix singular(3, 3, {Value(1, 2), Value(1), Value(2), Value(0), Value(3), Value(-1, 3),
+                         Value(1, 2), Value(4), Value(5, 3)});
+  threw = false;
+  try {
+    ModularSolve(singular, Matrix::Identity(3));
+  } catch (const std::domain_error &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+// Keeps the compiler from discarding a value computed in a benchmark loop.
+template <typename T> void Keep(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Operation>
+double MeasureOperation(std::size_t count, Operation operation) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; ++i) {
+    operation(i);
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(count);
+}
+
+// ns per +=, *= and <=> on random operands with numerators and denominators
+// below BENCHMARK_RANGE.
+template <typename R> void BenchmarkType(const char *type, std::size_t count) {
+  std::mt19937 generator(42);
+  std::vector<R> values;
+  values.reserve(BENCHMARK_VALUES);
+  for (std::size_t i = 0; i < BENCHMARK_VALUES; ++i) {
+    values.emplace_back(static_cast<int>(generator() % (2 * BENCHMARK_RANGE)) - BENCHMARK_RANGE,
+                        static_cast<int>(generator() % BENCHMARK_RANGE) + 1);
+  }
+  auto mask = BENCHMARK_VALUES - 1;
+  std::cout << type << ",+=," << MeasureOperation(count, [&](std::size_t i) {
+    auto value = values[i & mask];
+    value += values[(i + 1) & mask];
+    Keep(value);
+  }) << '\n';
+  std::cout << type << ",*=," << MeasureOperation(count, [&](std::size_t i) {
+    auto value = values[i & mask];
+    value *= values[(i + 1) & mask];
+    Keep(value);
+  }) << '\n';
+  std::cout << type << ",<=>," << MeasureOperation(count, [&](std::size_t i) {
+    auto order = values[i & mask] <=> values[(i + 1) & mask];
+    Keep(order);
+  }) << '\n';
+}
+
+void BenchmarkOperations(std::size_t count) {
+  std::mt19937 generator(42);
+  std::vector<int> operands(BENCHMARK_VALUES);
+  for (auto &operand : operands) {
+    operand = static_cast<int>(generator() % (BENCHMARK_RANGE * BENCHMARK_RANGE)) + 1;
+  }
+  auto mask = BENCHMARK_VALUES - 1;
+
+  std::cout << "type,operation,ns_per_op\n";
+  std::cout << "int,std::gcd," << MeasureOperation(count, [&](std::size_t i) {
+    Keep(std::gcd(operands[i & mask], operands[(i + 1) & mask]));
+  }) << '\n';
+  std::cout << "int,Gcd," << MeasureOperation(count, [&](std::size_t i) {
+    Keep(Gcd(operands[i & mask], operands[(i + 1) & mask]));
+  }) << '\n';
+  BenchmarkType<Rational<int>>("int", count);
+  BenchmarkType<Rational<long long>>("long long", count);
+  BenchmarkType<Rational<long long, Normalization::Lazy>>("long long lazy", count);
+  BenchmarkType<Rational<BigInt>>("BigInt", count);
+}
+
+// ns per counting insert (map[key] += 1) of count random keys with
+// numerators and denominators up to BENCHMARK_RANGE * 32, then per lookup of
+// the same keys (hits) and of as many fresh ones (mostly misses).
+template <typename R, typename Map>
+void BenchmarkMap(const char *type, const char *container, std::size_t count) {
+  std::mt19937 generator(42);
+  auto range = BENCHMARK_RANGE * 32;
+  auto randomKeys = [&] {
+    std::vector<R> keys;
+    keys.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      keys.emplace_back(static_cast<int>(generator() % (2 * range)) - range,
+                        static_cast<int>(generator() % range) + 1);
+    }
+    return keys;
+  };
+  auto keys = randomKeys();
+  auto misses = randomKeys();
+  auto contains = [](const Map &map, const R &key) {
+    if constexpr (requires { map.Contains(key); }) {
+      return map.Contains(key);
+    } else {
+      return map.contains(key);
+    }
+  };
+
+  Map map;
+  std::cout << type << ',' << container << ",insert,"
+            << MeasureOperation(count, [&](std::size_t i) { ++map[keys[i]]; }) << '\n';
+  std::cout << type << ',' << container << ",hit," << MeasureOperation(count, [&](std::size_t i) {
+    Keep(contains(map, keys[i]));
+  }) << '\n';
+  std::cout << type << ',' << container << ",miss," << MeasureOperation(count, [&](std::size_t i) {
+    Keep(contains(map, misses[i]));
+  }) << '\n';
+}
+
+template <typename R> void BenchmarkMaps(const char *type, std::size_t count) {
+  BenchmarkMap<R, FlatHashMap<R, int>>(type, "FlatHashMap", count);
+  BenchmarkMap<R, std::unordered_map<R, int>>(type, "std::unordered_map", count);
+  BenchmarkMap<R, std::map<R, int>>(type, "std::map", count);
+}
+
+void BenchmarkHash(std::size_t count) {
+  std::cout << "type,container,operation,ns_per_op\n";
+  BenchmarkMaps<Rational<int>>("int", count);
+  BenchmarkMaps<Rational<long long>>("long long", count);
+}
+
+// Seconds to solve a random size x size system with a few right-hand sides,
+// by Gaussian elimination over fractions and by Bareiss' elimination on one
+// thread and on all of them.
+void BenchmarkMatrix(std::size_t size) {
+  std::mt19937 generator(42);
+  auto matrix = RandomMatrix<BigInt>(size, size, BENCHMARK_RANGE, generator);
+  auto rhs = RandomMatrix<BigInt>(size, 4, BENCHMARK_RANGE, generator);
+  auto measure = [](auto solve) {
+    auto start = std::chrono::steady_clock::now();
+    auto solution = solve();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return std::pair(elapsed.count(), solution);
+  };
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  auto [gaussianTime, expected] = measure([&] { return GaussianSolve(matrix, rhs); });
+  auto [serialTime, serial] = measure([&] { return matrix.Solve(rhs); });
+  auto [parallelTime, parallel] = measure([&] { return matrix.Solve(rhs, threads); });
+  assert(serial == expected && parallel == expected);
+  std::cout << "method,threads,seconds\n";
+  std::cout << "gaussian,1," << gaussianTime << '\n';
+  std::cout << "bareiss,1," << serialTime << '\n';
+  std::cout << "bareiss," << threads << ',' << parallelTime << '\n';
+}
+
+// Seconds for a dot product and a polynomial of size * 64 random fractions
+// and for a random size x size system with a few right-hand sides, computed
+// directly in Rational<BigInt> (the system by Bareiss' elimination) and by
+// the multi-modular engine on one thread and on all of them.
+void BenchmarkModular(std::size_t size) {
+  using Value = Rational<BigInt>;
+  std::mt19937 generator(42);
+  auto randomValues = [&](std::size_t count) {
+    std::vector<Value> values;
+    values.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      values.emplace_back(static_cast<int>(generator() % (2 * BENCHMARK_RANGE)) - BENCHMARK_RANGE,
+                          static_cast<int>(generator() % BENCHMARK_RANGE) + 1);
+    }
+    return values;
+  };
+  auto lhs = randomValues(size * 64);
+  auto rhs = randomValues(size * 64);
+  Value x(-BENCHMARK_RANGE + 1, BENCHMARK_RANGE);
+  auto matrix = RandomMatrix<BigInt>(size, size, BENCHMARK_RANGE, generator);
+  auto columns = RandomMatrix<BigInt>(size, 4, BENCHMARK_RANGE, generator);
+
+  auto measure = [](auto compute) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = compute();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return std::pair(elapsed.count(), result);
+  };
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "workload,method,threads,seconds\n";
+  auto report = [&](const char *workload, auto direct, auto modular) {
+    auto [directTime, expected] = measure(direct);
+    auto [serialTime, serial] = measure([&] { return modular(1); });
+    auto [parallelTime, parallel] = measure([&] { return modular(threads); });
+    assert(serial == expected && parallel == expected);
+    std::cout << workload << ",direct,1," << directTime << '\n';
+    std::cout << workload << ",modular,1," << serialTime << '\n';
+    std::cout << workload << ",modular," << threads << ',' << parallelTime << '\n';
+  };
+  report(
+      "dot",
+      [&] {
+        Value sum;
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+          sum += lhs[i] * rhs[i];
+        }
+        return sum;
+      },
+      [&](std::size_t threadCount) { return ModularDot(lhs, rhs, threadCount); });
+  report(
+      "polynomial",
+      [&] {
+        Value value;
+        for (auto coefficient = lhs.rbegin(); coefficient != lhs.rend(); ++coefficient) {
+          value = value * x + *coefficient;
+        }
+        return value;
+      },
+      [&](std::size_t threadCount) { return ModularPolynomial(lhs, x, threadCount); });
+  report(
+      "solve", [&] { return matrix.Solve(columns); },
+      [&](std::size_t threadCount) { return ModularSolve(matrix, columns, threadCount); });
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2 && std::string_view(argv[1]) == "--bench") {
+    std::string_view name = argv[2];
+    if (name == "ops") {
+      BenchmarkOperations(argc > 3 ? std::stoul(argv[3]) : 1 << 24);
+    } else if (name == "hash") {
+      BenchmarkHash(argc > 3 ? std::stoul(argv[3]) : 1 << 20);
+    } else if (name == "matrix") {
+      BenchmarkMatrix(argc > 3 ? std::stoul(argv[3]) : 30);
+    } else if (name == "crt") {
+      BenchmarkModular(argc > 3 ? std::stoul(argv[3]) : 40);
+    }
+    return 0;
+  }
+
   TestInt();
   TestLongLong();
   TestIO();
+  TestOverflow();
+  TestBinaryGcd();
+  TestLazy();
+  TestBigInt();
+  TestBigRational();
+  TestHash();
+  TestDoubleConversion();
+  TestMatrix();
+  TestMultiModular();
   return 0;
 }
\ No newline at end of file
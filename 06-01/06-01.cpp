@@ -1,9 +1,47 @@
 #include "Rational.hpp"
+#include "RationalIO.hpp"
+#include "RationalReduce.hpp"
+#include "RationalVector.hpp"
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <iostream>
+#include <limits>
+#include <random>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 const double EPSILON_VAL = 1e-6;
+const int VECTOR_RANGE = 1 << 10;
+
+// Rational is a literal type, so these are folded by the compiler.
+constexpr Rational THIRD(1, 3);
+constexpr auto HARMONIC_10 = [] {
+  Rational sum;
+  for (int i = 1; i <= 10; ++i) {
+    sum += Rational(1, i);
+  }
+  return sum;
+}();
+
+static_assert(THIRD + THIRD == Rational(2, 3));
+static_assert(Rational(6, -8) == Rational(-3, 4));
+static_assert(Rational(1, 2) * Rational(2, 3) < Rational(1, 2));
+static_assert(++Rational(THIRD) == Rational(4, 3));
+static_assert(static_cast<double>(Rational(1, 4)) == 0.25);
+static_assert(HARMONIC_10 == Rational(7381, 2520));
+static_assert(Rational(2147483647, 2) > Rational(2147483645, 2));
+static_assert(Rational(-2147483647, 65536) < Rational(-2147483645, 65536));
+static_assert(std::hash<Rational>{}(Rational(2, 4)) == std::hash<Rational>{}(Rational(-1, -2)));
 
 bool AreDoublesEqual(double x, double y) {
   return std::abs(x - y) < EPSILON_VAL;
@@ -67,16 +105,496 @@ void TestIO() {
   assert(r2 == Rational(5, 8));
 }
 
+void TestReducedArithmetic() {
+  assert(Rational(1, 6) + Rational(1, 3) == Rational(1, 2));
+  assert(Rational(7, 12) + Rational(5, 12) == Rational(1));
+  assert(Rational(3, 10) - Rational(3, 10) == Rational(0));
+  assert(Rational(-5, 8) + Rational(1, 24) == Rational(-7, 12));
+  assert(Rational(6, 35) * Rational(14, 9) == Rational(4, 15));
+  assert(Rational(0) * Rational(3, 7) == Rational(0));
+  assert(Rational(48, -18) == Rational(-8, 3));
+}
+
+void TestHash() {
+  std::hash<Rational> hash;
+  assert(hash(Rational(1, 2)) != hash(Rational(2, 1)));
+  assert(hash(Rational(-1, 2)) != hash(Rational(1, 2)));
+
+  std::unordered_set<Rational> distinct;
+  std::unordered_map<Rational, int> counts;
+  for (int den = 1; den <= 12; ++den) {
+    for (int num = 0; num <= den; ++num) {
+      distinct.insert(Rational(num, den));
+      ++counts[Rational(num, den)];
+    }
+  }
+  // The Farey sequence of order 12 has 47 terms.
+  assert(distinct.size() == 47);
+  assert(counts.at(Rational(1, 2)) == 6 && counts.at(Rational(0)) == 12);
+}
+
 void TestDoubleConversion() {
   Rational r(1, 2);
   assert(AreDoublesEqual(static_cast<double>(r), 0.5));
 }
 
-int main() {
+void TestFromDouble() {
+  assert(Rational::FromDouble(0.5) == Rational(1, 2));
+  assert(Rational::FromDouble(-0.1) == Rational(-1, 10));
+  assert(Rational::FromDouble(M_PI, 100) == Rational(311, 99));
+  assert(Rational::FromDouble(M_PI, 1000) == Rational(355, 113));
+  assert(Rational::FromDouble(0.5, 1) == Rational(0));
+  assert(Rational::FromDouble(1e-12) == Rational(0));
+  assert(Rational::FromDouble(2147483647.7) == Rational(2147483647));
+  bool threw = false;
+  try {
+    Rational::FromDouble(3e9);
+  } catch (const std::overflow_error &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // The lanes must agree with the scalar path everywhere, including the
+  // values they hand back to it: zero, tiny, huge and tied ones.
+  std::mt19937 generator(11);
+  std::vector<double> values = {0.0, -0.0, 0.5, -1.5, 1e-5, 1e-300, 2147483646.5, 1.0 / 3};
+  for (int i = 0; i < 20000; ++i) {
+    auto magnitude = std::ldexp(static_cast<double>(generator()) / 4294967296.0,
+                                static_cast<int>(generator() % 43) - 12);
+    values.push_back(generator() % 2 == 0 ? magnitude : -magnitude);
+    values.push_back(static_cast<double>(static_cast<int>(generator() % 200) - 100) /
+                     static_cast<double>(generator() % 200 + 1));
+  }
+  for (int maxDen : {1, 7, 1000, 65536, std::numeric_limits<int>::max()}) {
+    auto vector = RationalVector::FromDoubles(values, maxDen);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      assert(vector[i] == Rational::FromDouble(values[i], maxDen));
+    }
+  }
+}
+
+// Nonzero values with numerators and denominators up to VECTOR_RANGE.
+std::vector<Rational> RandomRationals(std::size_t size, std::mt19937 &generator) {
+  std::vector<Rational> values;
+  values.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    auto num = static_cast<int>(generator() % VECTOR_RANGE) + 1;
+    values.emplace_back(generator() % 2 == 0 ? num : -num,
+                        static_cast<int>(generator() % VECTOR_RANGE) + 1);
+  }
+  return values;
+}
+
+void TestRationalVector() {
+  std::mt19937 generator(42);
+  // 1000 leaves a partial register at the end for every lane count.
+  auto lhs = RandomRationals(1000, generator);
+  auto rhs = RandomRationals(1000, generator);
+  rhs[0] = Rational(0);
+  RationalVector left(lhs);
+  RationalVector right(rhs);
+
+  auto check = [&](const RationalVector &result, auto operation) {
+    assert(result.Size() == lhs.size());
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+      assert(result[i] == operation(lhs[i], rhs[i]));
+    }
+  };
+  check(left + right, [](Rational a, Rational b) { return a + b; });
+  check(left - right, [](Rational a, Rational b) { return a - b; });
+  check(left - left, [](Rational, Rational) { return Rational(0); });
+  check(left * right, [](Rational a, Rational b) { return a * b; });
+  auto divisor = right;
+  divisor.Set(0, Rational(-3, 7));
+  auto quotient = left / divisor;
+  assert(quotient[0] == lhs[0] / Rational(-3, 7));
+  for (std::size_t i = 1; i < lhs.size(); ++i) {
+    assert(quotient[i] == lhs[i] / rhs[i]);
+  }
+
+  auto less = left.Less(right);
+  auto equal = left.Equal(right);
+  auto same = left.Equal(RationalVector(lhs));
+  auto doubles = left.ToDoubles();
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    assert(less[i] == (lhs[i] < rhs[i]));
+    assert(equal[i] == (lhs[i] == rhs[i]));
+    assert(same[i] == 1);
+    assert(AreDoublesEqual(doubles[i], static_cast<double>(lhs[i])));
+  }
+
+  std::vector<int> numerators{6, -4, 0, 9, 7, 1 << 20, 0, 12};
+  std::vector<int> denominators{-8, 6, 5, 3, -7, 1 << 18, 1, -18};
+  RationalVector raw(numerators, denominators);
+  for (std::size_t i = 0; i < numerators.size(); ++i) {
+    assert(raw[i] == Rational(numerators[i], denominators[i]));
+    assert(raw.Denominators()[i] == Rational(numerators[i], denominators[i]).Denominator());
+  }
+  assert(raw.ToRationals()[0] == Rational(-3, 4));
+}
+
+void TestParseFormat() {
+  Rational value;
+  std::string_view text = "-6/8,";
+  auto parsed = ParseRational(text.data(), text.data() + text.size(), value);
+  assert(parsed.ec == std::errc{} && *parsed.ptr == ',');
+  assert(value == Rational(-3, 4));
+
+  text = "17";
+  parsed = ParseRational(text.data(), text.data() + text.size(), value);
+  assert(parsed.ec == std::errc{} && value == Rational(17));
+
+  for (std::string_view bad : {"x/2", "1/0", "1/", "99999999999/2"}) {
+    value = Rational(5);
+    parsed = ParseRational(bad.data(), bad.data() + bad.size(), value);
+    assert(parsed.ec != std::errc{});
+    assert(value == Rational(5));
+  }
+  for (std::string_view bad : {"x/2", "1/x", "1/", "1/0", "1/-"}) {
+    parsed = ParseRational(bad.data(), bad.data() + bad.size(), value);
+    assert(parsed.ec == std::errc::invalid_argument && parsed.ptr == bad.data());
+  }
+
+  char buffer[MAX_RATIONAL_CHARS];
+  auto formatted = FormatRational(buffer, buffer + sizeof(buffer), Rational(-2147483647, 2147483646));
+  assert(formatted.ec == std::errc{});
+  assert(std::string_view(buffer, formatted.ptr - buffer) == "-2147483647/2147483646");
+  assert(FormatRational(buffer, buffer + 3, Rational(1, 1000)).ec == std::errc::value_too_large);
+
+#if defined(__cpp_lib_format)
+  assert(std::format("{}|{:>6}", Rational(3, 4), Rational(-1, 2)) == "3/4|  -1/2");
+#endif
+}
+
+std::string FormatText(const std::vector<Rational> &values, char separator) {
+  std::string text;
+  char buffer[MAX_RATIONAL_CHARS];
+  for (const auto &value : values) {
+    auto result = FormatRational(buffer, buffer + sizeof(buffer), value);
+    text.append(buffer, result.ptr);
+    text += separator;
+  }
+  return text;
+}
+
+void TestParseRationals() {
+  assert(ParseRationals("").empty());
+  auto small = ParseRationals(" 1/2,\r\n-3/9\t4\n\n,5/10");
+  assert((small == std::vector<Rational>{Rational(1, 2), Rational(-1, 3), Rational(4), Rational(1, 2)}));
+
+  auto malformed = [](std::string_view text, std::size_t threads) {
+    try {
+      ParseRationals(text, threads);
+    } catch (const std::invalid_argument &) {
+      return true;
+    }
+    return false;
+  };
+  assert(malformed("1/2\n3//4", 1));
+  assert(malformed("1/2 3/4x", 1));
+
+  std::mt19937 generator(7);
+  auto values = RandomRationals(100000, generator);
+  auto text = FormatText(values, '\n');
+  for (std::size_t threads : {1, 3, 8}) {
+    assert(ParseRationals(text, threads) == values);
+  }
+  text[text.size() / 2] = '?';
+  assert(malformed(text, 4));
+
+#ifdef __linux__
+  auto path = (std::filesystem::temp_directory_path() / "06-01-rationals.txt").string();
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << FormatText(values, ',');
+  }
+  assert(ReadRationals(path, 4) == values);
+  std::remove(path.c_str());
+#endif
+}
+
+// Values with numerators in [-range, range] and power-of-two denominators up
+// to 2^maxShift, whose sums always fit.
+std::vector<Rational> GridRationals(std::size_t size, int range, int maxShift, std::mt19937 &generator) {
+  std::vector<Rational> values;
+  values.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    values.emplace_back(static_cast<int>(generator() % (2 * range + 1)) - range,
+                        1 << (generator() % (maxShift + 1)));
+  }
+  return values;
+}
+
+void TestReduce() {
+  std::vector<Rational> harmonic;
+  for (int i = 1; i <= 20; ++i) {
+    harmonic.emplace_back(1, i);
+  }
+  assert(ReduceSum(harmonic) == Rational(55835135, 15519504));
+  assert(ReduceSum(std::vector<Rational>{}) == Rational(0));
+
+  std::mt19937 generator(7);
+  auto values = GridRationals(100000, 8, 4, generator);
+  long long sixteenths = 0;
+  for (const auto &value : values) {
+    sixteenths += value.Numerator() * (16 / value.Denominator());
+  }
+  Rational expected(static_cast<int>(sixteenths), 16);
+  for (std::size_t threads : {1, 3, 8}) {
+    assert(ReduceSum(values, threads) == expected);
+    assert(ReduceSum(RationalVector(values), threads) == expected);
+  }
+
+  auto lhs = RandomRationals(3000, generator);
+  auto rhs = GridRationals(3000, 3, 2, generator);
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    lhs[i] = Rational(lhs[i].Numerator() % 7, lhs[i].Denominator() % 6 + 1);
+  }
+  Rational dot;
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    dot += lhs[i] * rhs[i];
+  }
+  assert(Dot(lhs, rhs) == dot && Dot(lhs, rhs, 4) == dot);
+  assert(Dot(RationalVector(lhs), RationalVector(rhs), 2) == dot);
+
+  // Intermediates far beyond int cancel out; a left fold of += would
+  // overflow on the first pair.
+  constexpr int P = 2147483647;
+  constexpr int Q = 2147483629;
+  assert(ReduceSum(std::vector{Rational(1, P), Rational(1, Q), Rational(-1, P), Rational(-1, Q)}) == Rational(0));
+  assert(Dot(std::vector{Rational(P, 2), Rational(P)}, std::vector{Rational(Q), Rational(-Q, 2)}) == Rational(0));
+
+  auto throws = [](auto operation, auto error) {
+    try {
+      operation();
+    } catch (const decltype(error) &) {
+      return true;
+    }
+    return false;
+  };
+  assert(throws([] { ReduceSum(std::vector{Rational(1, P), Rational(1, Q)}); }, std::overflow_error("")));
+  assert(throws([&] { Dot(lhs, values); }, std::invalid_argument("")));
+}
+
+// ns per element for a loop of scalar operators against the batch kernels.
+void BenchmarkVector(std::size_t size) {
+  std::mt19937 generator(42);
+  auto lhs = RandomRationals(size, generator);
+  auto rhs = RandomRationals(size, generator);
+  RationalVector left(lhs);
+  RationalVector right(rhs);
+
+  auto measure = [size](auto operation) {
+    auto start = std::chrono::steady_clock::now();
+    operation();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(size);
+  };
+  auto report = [&](const char *name, auto scalar, auto vector) {
+    std::vector<Rational> results(size);
+    auto scalarTime = measure([&] {
+      for (std::size_t i = 0; i < size; ++i) {
+        results[i] = scalar(lhs[i], rhs[i]);
+      }
+    });
+    RationalVector result;
+    auto vectorTime = measure([&] { result = vector(left, right); });
+    assert(result.ToRationals() == results);
+    std::cout << name << ',' << scalarTime << ',' << vectorTime << ','
+              << scalarTime / vectorTime << '\n';
+  };
+
+  std::cout << "operation,scalar_ns,vector_ns,speedup\n";
+  report("add", [](Rational a, Rational b) { return a + b; },
+         [](const RationalVector &a, const RationalVector &b) { return a + b; });
+  report("subtract", [](Rational a, Rational b) { return a - b; },
+         [](const RationalVector &a, const RationalVector &b) { return a - b; });
+  report("multiply", [](Rational a, Rational b) { return a * b; },
+         [](const RationalVector &a, const RationalVector &b) { return a * b; });
+  report("divide", [](Rational a, Rational b) { return a / b; },
+         [](const RationalVector &a, const RationalVector &b) { return a / b; });
+
+  std::vector<double> inputs(size);
+  std::uniform_real_distribution<double> distribution(-VECTOR_RANGE, VECTOR_RANGE);
+  for (auto &input : inputs) {
+    input = distribution(generator);
+  }
+  std::vector<Rational> approximations(size);
+  auto scalarTime = measure([&] {
+    for (std::size_t i = 0; i < size; ++i) {
+      approximations[i] = Rational::FromDouble(inputs[i], VECTOR_RANGE);
+    }
+  });
+  RationalVector result;
+  auto vectorTime = measure([&] { result = RationalVector::FromDoubles(inputs, VECTOR_RANGE); });
+  assert(result.ToRationals() == approximations);
+  std::cout << "from_double," << scalarTime << ',' << vectorTime << ',' << scalarTime / vectorTime << '\n';
+}
+
+// Parse and format throughput in MB/s of the stream operators against
+// ParseRationals and FormatRational.
+void BenchmarkParse(std::size_t count) {
+  std::mt19937 generator(42);
+  auto values = RandomRationals(count, generator);
+  auto text = FormatText(values, '\n');
+  auto megabytes = static_cast<double>(text.size()) / 1e6;
+
+  auto measure = [megabytes](auto operation) {
+    auto start = std::chrono::steady_clock::now();
+    operation();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return megabytes / elapsed.count();
+  };
+
+  std::cout << "method,mb_per_s\n";
+  std::cout << "stream_parse," << measure([&] {
+    std::istringstream stream(text);
+    std::vector<Rational> parsed;
+    Rational value;
+    while (stream >> value) {
+      parsed.push_back(value);
+    }
+    assert(parsed == values);
+  }) << '\n';
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threadCount = 1; threadCount <= threads; threadCount *= 2) {
+    std::cout << "parse_" << threadCount << "_threads," << measure([&] {
+      assert(ParseRationals(text, threadCount) == values);
+    }) << '\n';
+  }
+  std::cout << "stream_format," << measure([&] {
+    std::ostringstream stream;
+    for (const auto &value : values) {
+      stream << value << '\n';
+    }
+    assert(stream.str() == text);
+  }) << '\n';
+  std::cout << "format," << measure([&] { assert(FormatText(values, '\n') == text); }) << '\n';
+}
+
+// The operators as callers outside the defining translation unit saw them
+// while they lived in Rational.cpp: a call per operation.
+[[gnu::noinline]] Rational AddCall(Rational lhs, const Rational &rhs) {
+  return lhs += rhs;
+}
+
+[[gnu::noinline]] Rational MultiplyCall(Rational lhs, const Rational &rhs) {
+  return lhs *= rhs;
+}
+
+[[gnu::noinline]] bool LessCall(const Rational &lhs, const Rational &rhs) {
+  return lhs < rhs;
+}
+
+// ns per operation inlined from the header against the same operation behind
+// a call.
+void BenchmarkInline(std::size_t count) {
+  std::mt19937 generator(42);
+  auto values = RandomRationals(count + 1, generator);
+
+  auto measure = [count](auto operation) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = operation();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return std::pair(elapsed.count() / static_cast<double>(count), result);
+  };
+  // Folds every result into a checksum so that neither loop is optimized
+  // away and both can be checked against each other.
+  auto run = [&](auto operation) {
+    return measure([&] {
+      long long checksum = 0;
+      for (std::size_t i = 0; i < count; ++i) {
+        Rational result = operation(values[i], values[i + 1]);
+        checksum += result.Numerator() ^ result.Denominator();
+      }
+      return checksum;
+    });
+  };
+  auto report = [&](const char *name, auto inlined, auto called) {
+    auto [inlineTime, inlineChecksum] = run(inlined);
+    auto [callTime, callChecksum] = run(called);
+    assert(inlineChecksum == callChecksum);
+    std::cout << name << ',' << inlineTime << ',' << callTime << '\n';
+  };
+
+  std::cout << "operation,inline_ns,call_ns\n";
+  report("+=", [](Rational a, const Rational &b) { return a += b; }, AddCall);
+  report("*=", [](Rational a, const Rational &b) { return a *= b; }, MultiplyCall);
+  report("<", [](const Rational &a, const Rational &b) { return Rational(a < b); },
+         [](const Rational &a, const Rational &b) { return Rational(LessCall(a, b)); });
+}
+
+// ns per element for a left fold of += against ReduceSum and Dot, on one
+// thread and on all of them.
+void BenchmarkReduce(std::size_t size) {
+  std::mt19937 generator(42);
+  auto lhs = GridRationals(size, 3, 6, generator);
+  auto rhs = GridRationals(size, 3, 2, generator);
+
+  auto measure = [size](auto operation) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = operation();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return std::pair(elapsed.count() / static_cast<double>(size), result);
+  };
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  auto report = [&](const char *name, auto fold, auto reduce) {
+    auto [foldTime, expected] = measure(fold);
+    auto [serialTime, serial] = measure([&] { return reduce(1); });
+    auto [parallelTime, parallel] = measure([&] { return reduce(threads); });
+    assert(serial == expected && parallel == expected);
+    std::cout << name << ',' << foldTime << ',' << serialTime << ',' << parallelTime << '\n';
+  };
+
+  std::cout << "operation,fold_ns,reduce_ns,reduce_" << threads << "_threads_ns\n";
+  report(
+      "sum",
+      [&] {
+        Rational sum;
+        for (const auto &value : lhs) {
+          sum += value;
+        }
+        return sum;
+      },
+      [&](std::size_t threadCount) { return ReduceSum(lhs, threadCount); });
+  report(
+      "dot",
+      [&] {
+        Rational sum;
+        for (std::size_t i = 0; i < size; ++i) {
+          sum += lhs[i] * rhs[i];
+        }
+        return sum;
+      },
+      [&](std::size_t threadCount) { return Dot(lhs, rhs, threadCount); });
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2 && std::string_view(argv[1]) == "--bench") {
+    std::string_view name = argv[2];
+    if (name == "vector") {
+      BenchmarkVector(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    } else if (name == "parse") {
+      BenchmarkParse(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    } else if (name == "inline") {
+      BenchmarkInline(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    } else if (name == "reduce") {
+      BenchmarkReduce(argc > 3 ? std::stoul(argv[3]) : 1 << 22);
+    }
+    return 0;
+  }
+
   TestArithmetic();
   TestIncrementDecrement();
   TestComparison();
   TestIO();
+  TestReducedArithmetic();
+  TestHash();
   TestDoubleConversion();
+  TestFromDouble();
+  TestRationalVector();
+  TestParseFormat();
+  TestParseRationals();
+  TestReduce();
   return 0;
 }
\ No newline at end of file
@@ -1,58 +1,132 @@
 #include "Rational.hpp"
 
 #include <cmath>
-#include <numeric>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
 
-Rational::Rational(int num, int den) : num_(num), den_(den)
+namespace
 {
-    Reduce();
-}
-
-Rational& Rational::operator+=(const Rational& other)
-{
-    auto lcm = std::lcm(den_, other.den_);
-    num_ = num_ * (lcm / den_) + other.num_ * (lcm / other.den_);
-    den_ = lcm;
-    Reduce();
-    return *this;
-}
-
-Rational& Rational::operator-=(const Rational& other)
-{
-    return *this += Rational(-other.num_, other.den_);
-}
 
-Rational& Rational::operator*=(const Rational& other)
-{
-    num_ *= other.num_;
-    den_ *= other.den_;
-    Reduce();
-    return *this;
-}
+__extension__ using UInt128 = unsigned __int128;
 
-Rational& Rational::operator/=(const Rational& other)
+// Whether a / b < c / d for positive b and d, compared through the continued
+// fractions of both sides so that nothing is multiplied and nothing overflows.
+template <typename Word>
+bool FractionLess(Word a, Word b, Word c, Word d)
 {
-    return *this *= Rational(other.den_, other.num_);
-}
-
-Rational& Rational::operator++()
-{
-    return *this += 1;
+    while (true)
+    {
+        auto lhs = a / b;
+        auto rhs = c / d;
+        if (lhs != rhs)
+        {
+            return lhs < rhs;
+        }
+        a -= lhs * b;
+        c -= rhs * d;
+        if (c == 0)
+        {
+            return false;
+        }
+        if (a == 0)
+        {
+            return true;
+        }
+        // a / b < c / d exactly when d / c < b / a.
+        std::swap(a, d);
+        std::swap(b, c);
+    }
 }
 
-Rational& Rational::operator--()
+// Best approximation h / k of p / q with h <= maxNum and 1 <= k <= maxDen.
+// Euclid's algorithm on (p, q) yields the partial quotients; the walk stops
+// at the first convergent outside the bounds and picks between the previous
+// convergent h1 / k1 and the largest semiconvergent (m * h1 + h0) /
+// (m * k1 + k0) inside them, which is closer exactly when the complete
+// quotient p / q is below 2m + k0 / k1.
+template <typename Word>
+std::pair<std::uint64_t, std::uint64_t> BoundedContinuedFraction(Word p, Word q, std::uint64_t maxNum,
+                                                                  std::uint64_t maxDen)
 {
-    return *this -= 1;
+    std::uint64_t h0 = 0;
+    std::uint64_t h1 = 1;
+    std::uint64_t k0 = 1;
+    std::uint64_t k1 = 0;
+    while (true)
+    {
+        auto quotient = p / q;
+        auto limit = ~Word(0);
+        if (h1 != 0)
+        {
+            limit = (maxNum - h0) / h1;
+        }
+        if (k1 != 0)
+        {
+            limit = std::min<Word>(limit, (maxDen - k0) / k1);
+        }
+        if (quotient > limit)
+        {
+            if (k1 == 0)
+            {
+                throw std::overflow_error("Rational: value does not fit");
+            }
+            auto m = static_cast<std::uint64_t>(limit);
+            if (m >= 1 && FractionLess<Word>(p, q, 2 * m * k1 + k0, k1))
+            {
+                return {m * h1 + h0, m * k1 + k0};
+            }
+            return {h1, k1};
+        }
+        auto a = static_cast<std::uint64_t>(quotient);
+        h0 = std::exchange(h1, a * h1 + h0);
+        k0 = std::exchange(k1, a * k1 + k0);
+        auto remainder = p - quotient * q;
+        if (remainder == 0)
+        {
+            return {h1, k1};
+        }
+        p = std::exchange(q, remainder);
+    }
 }
 
-std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs)
-{
-    return (lhs.num_ * rhs.den_) <=> (rhs.num_ * lhs.den_);
-}
+} // namespace
 
-bool operator==(const Rational& lhs, const Rational& rhs)
+// Runs on the exact value of x, mantissa / 2^scale. Below 2^-33 the answer is
+// 0 for any int denominator, so scale stays within 128 bits, and within 64
+// for the common magnitudes.
+Rational Rational::FromDouble(double x, int maxDen)
 {
-    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+    if (!std::isfinite(x) || maxDen < 1)
+    {
+        throw std::invalid_argument("Rational: no approximation of a non-finite value");
+    }
+    auto magnitude = std::abs(x);
+    int exponent = 0;
+    auto mantissa = static_cast<std::uint64_t>(std::ldexp(std::frexp(magnitude, &exponent), 53));
+    auto scale = 53 - exponent;
+    constexpr std::uint64_t maxNum = std::numeric_limits<int>::max();
+    std::pair<std::uint64_t, std::uint64_t> best{0, 1};
+    if (scale <= 0)
+    {
+        if (magnitude > static_cast<double>(maxNum))
+        {
+            throw std::overflow_error("Rational: value does not fit");
+        }
+        best.first = static_cast<std::uint64_t>(magnitude);
+    }
+    else if (mantissa != 0 && scale <= 86)
+    {
+        auto zeros = std::min(std::countr_zero(mantissa), scale);
+        mantissa >>= zeros;
+        scale -= zeros;
+        best = scale < 64 ? BoundedContinuedFraction<std::uint64_t>(mantissa, std::uint64_t(1) << scale,
+                                                                    maxNum, static_cast<std::uint64_t>(maxDen))
+                          : BoundedContinuedFraction<UInt128>(mantissa, UInt128(1) << scale, maxNum,
+                                                              static_cast<std::uint64_t>(maxDen));
+    }
+    auto num = static_cast<int>(best.first);
+    return Rational(x < 0 ? -num : num, static_cast<int>(best.second), Reduced{});
 }
 
 std::istream& operator>>(std::istream& stream, Rational& rational)
@@ -67,15 +141,3 @@ std::ostream& operator<<(std::ostream& stream, const Rational& rational)
 {
     return stream << rational.num_ << '/' << rational.den_;
 }
-
-void Rational::Reduce()
-{
-    if (den_ < 0)
-    {
-        num_ = -num_;
-        den_ = -den_;
-    }
-    auto common = std::gcd(num_, den_);
-    num_ /= common;
-    den_ /= common;
-}
\ No newline at end of file
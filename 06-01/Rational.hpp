@@ -1,14 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <compare>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
-#include <numeric>
+#include <limits>
 
 template <typename T>
 struct Addable
 {
-    friend T operator+(T lhs, const T& rhs)
+    friend constexpr T operator+(T lhs, const T& rhs)
     {
         return lhs += rhs;
     }
@@ -17,7 +22,7 @@ struct Addable
 template <typename T>
 struct Subtractable
 {
-    friend T operator-(T lhs, const T& rhs)
+    friend constexpr T operator-(T lhs, const T& rhs)
     {
         return lhs -= rhs;
     }
@@ -26,7 +31,7 @@ struct Subtractable
 template <typename T>
 struct Multipliable
 {
-    friend T operator*(T lhs, const T& rhs)
+    friend constexpr T operator*(T lhs, const T& rhs)
     {
         return lhs *= rhs;
     }
@@ -35,7 +40,7 @@ struct Multipliable
 template <typename T>
 struct Dividable
 {
-    friend T operator/(T lhs, const T& rhs)
+    friend constexpr T operator/(T lhs, const T& rhs)
     {
         return lhs /= rhs;
     }
@@ -44,7 +49,7 @@ struct Dividable
 template <typename T>
 struct Incrementable
 {
-    T operator++(int)
+    constexpr T operator++(int)
     {
         auto& self = static_cast<T&>(*this);
         T temp(self);
@@ -56,7 +61,7 @@ struct Incrementable
 template <typename T>
 struct Decrementable
 {
-    T operator--(int)
+    constexpr T operator--(int)
     {
         auto& self = static_cast<T&>(*this);
         T temp(self);
@@ -65,6 +70,31 @@ struct Decrementable
     }
 };
 
+// Binary GCD: one countr_zero strips the common power of two, and the loop
+// only shifts and subtracts, avoiding the divisions of Euclid's algorithm.
+constexpr int BinaryGcd(int a, int b)
+{
+    auto x = a < 0 ? 0u - static_cast<unsigned>(a) : static_cast<unsigned>(a);
+    auto y = b < 0 ? 0u - static_cast<unsigned>(b) : static_cast<unsigned>(b);
+    if (x == 0 || y == 0)
+    {
+        return static_cast<int>(x | y);
+    }
+    auto shift = std::countr_zero(x | y);
+    x >>= std::countr_zero(x);
+    do
+    {
+        y >>= std::countr_zero(y);
+        auto low = std::min(x, y);
+        y = std::max(x, y) - low;
+        x = low;
+    } while (y != 0);
+    return static_cast<int>(x << shift);
+}
+
+// Everything but the stream operators is constexpr and defined in this
+// header, so calls inline across translation units and Rational constants
+// fold at compile time.
 class Rational :
     public Addable<Rational>,
     public Subtractable<Rational>,
@@ -74,33 +104,157 @@ class Rational :
     public Decrementable<Rational>
 {
 public:
-    Rational(int num = 0, int den = 1);
+    constexpr Rational(int num = 0, int den = 1);
 
-    explicit operator double() const
+    // Both ints convert to double exactly, so the one division rounds
+    // correctly.
+    constexpr explicit operator double() const
     {
         return static_cast<double>(num_) / static_cast<double>(den_);
     }
 
-    Rational& operator+=(const Rational& other);
-    Rational& operator-=(const Rational& other);
-    Rational& operator*=(const Rational& other);
-    Rational& operator/=(const Rational& other);
+    // The closest fraction to x with a denominator up to maxDen and a
+    // numerator that fits in an int. Throws std::invalid_argument for NaN,
+    // infinities or maxDen < 1 and std::overflow_error when the integer part
+    // of x does not fit.
+    static Rational FromDouble(double x, int maxDen = std::numeric_limits<int>::max());
+
+    constexpr int Numerator() const
+    {
+        return num_;
+    }
+
+    constexpr int Denominator() const
+    {
+        return den_;
+    }
+
+    constexpr Rational& operator+=(const Rational& other);
+    constexpr Rational& operator-=(const Rational& other);
+    constexpr Rational& operator*=(const Rational& other);
+    constexpr Rational& operator/=(const Rational& other);
 
-    Rational& operator++();
-    Rational& operator--();
+    constexpr Rational& operator++();
+    constexpr Rational& operator--();
 
     using Incrementable<Rational>::operator++;
     using Decrementable<Rational>::operator--;
 
-    friend std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs);
-    friend bool operator==(const Rational& lhs, const Rational& rhs);
+    friend constexpr std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs);
+    friend constexpr bool operator==(const Rational& lhs, const Rational& rhs);
 
     friend std::istream& operator>>(std::istream& stream, Rational& rational);
     friend std::ostream& operator<<(std::ostream& stream, const Rational& rational);
 
 private:
-    void Reduce();
+    friend class RationalVector;
+
+    // Adopts a pair that is already in lowest terms with a positive
+    // denominator, as the batch kernels produce them.
+    struct Reduced
+    {
+    };
+
+    constexpr Rational(int num, int den, Reduced) : num_(num), den_(den)
+    {
+    }
+
+    constexpr void Reduce();
 
     int num_;
     int den_;
-};
\ No newline at end of file
+};
+
+constexpr Rational::Rational(int num, int den) : num_(num), den_(den)
+{
+    Reduce();
+}
+
+// Knuth, TAOCP 4.5.1: with d1 = gcd(den_, other.den_) the sum is
+// t / (den_ / d1 * other.den_) for t = num_ * (other.den_ / d1) +
+// other.num_ * (den_ / d1), and only d2 = gcd(t, d1) can still divide it.
+constexpr Rational& Rational::operator+=(const Rational& other)
+{
+    auto d1 = BinaryGcd(den_, other.den_);
+    auto t = num_ * (other.den_ / d1) + other.num_ * (den_ / d1);
+    if (t == 0)
+    {
+        num_ = 0;
+        den_ = 1;
+        return *this;
+    }
+    auto d2 = BinaryGcd(t, d1);
+    num_ = t / d2;
+    den_ = (den_ / d1) * (other.den_ / d2);
+    return *this;
+}
+
+constexpr Rational& Rational::operator-=(const Rational& other)
+{
+    return *this += Rational(-other.num_, other.den_);
+}
+
+// Both operands are in lowest terms, so cancelling each numerator against
+// the other denominator leaves a product that needs no Reduce.
+constexpr Rational& Rational::operator*=(const Rational& other)
+{
+    auto left = BinaryGcd(num_, other.den_);
+    auto right = BinaryGcd(other.num_, den_);
+    num_ = (num_ / left) * (other.num_ / right);
+    den_ = (den_ / right) * (other.den_ / left);
+    return *this;
+}
+
+constexpr Rational& Rational::operator/=(const Rational& other)
+{
+    return *this *= Rational(other.den_, other.num_);
+}
+
+constexpr Rational& Rational::operator++()
+{
+    return *this += 1;
+}
+
+constexpr Rational& Rational::operator--()
+{
+    return *this -= 1;
+}
+
+// The cross products are taken in 64 bits, where no product of two ints
+// overflows, so the comparison is exact for every pair of values.
+constexpr std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs)
+{
+    return static_cast<long long>(lhs.num_) * rhs.den_ <=> static_cast<long long>(rhs.num_) * lhs.den_;
+}
+
+constexpr bool operator==(const Rational& lhs, const Rational& rhs)
+{
+    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+}
+
+constexpr void Rational::Reduce()
+{
+    if (den_ < 0)
+    {
+        num_ = -num_;
+        den_ = -den_;
+    }
+    auto common = BinaryGcd(num_, den_);
+    num_ /= common;
+    den_ /= common;
+}
+
+// Every value has a single reduced form, so hashing (num_, den_) agrees with
+// ==. The pair fills one 64-bit word; the multiply spreads it upwards and the
+// final shift folds the high bits back into the low ones buckets are picked by.
+template <>
+struct std::hash<Rational>
+{
+    constexpr std::size_t operator()(const Rational& rational) const noexcept
+    {
+        auto word = static_cast<std::uint64_t>(static_cast<std::uint32_t>(rational.Numerator())) << 32 |
+                    static_cast<std::uint32_t>(rational.Denominator());
+        word *= 0x9e3779b97f4a7c15;
+        return static_cast<std::size_t>(word ^ (word >> 32));
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Rational.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <version>
+
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+// Longest text FormatRational writes: two signed ints and the slash.
+inline constexpr std::size_t MAX_RATIONAL_CHARS = 23;
+
+// Parses "num/den" or a bare "num" at the start of [first, last), like
+// std::from_chars: ptr points past the fraction on success, ec tells what went
+// wrong otherwise, and value is only assigned on success. Text that is not a
+// fraction, including a missing or zero denominator after the slash, is
+// std::errc::invalid_argument with ptr == first; an int out of range is
+// std::errc::result_out_of_range with ptr past its digits. Nothing is
+// allocated and no locale is read.
+std::from_chars_result ParseRational(const char* first, const char* last, Rational& value);
+
+// Writes value as "num/den" like std::to_chars.
+std::to_chars_result FormatRational(char* first, char* last, const Rational& value);
+
+// Parses fractions separated by any mix of newlines, commas, spaces and tabs.
+// With more than one thread the text is cut into that many chunks, each moved
+// forward to the next separator, and parsed concurrently; the order of the
+// result is the order of the text either way. Malformed input throws
+// std::invalid_argument naming its byte offset.
+std::vector<Rational> ParseRationals(std::string_view text, std::size_t threadCount = 1);
+
+#ifdef __linux__
+// ParseRationals over a memory-mapped file, so the text is never copied.
+std::vector<Rational> ReadRationals(const std::string& path, std::size_t threadCount = 1);
+#endif
+
+#if defined(__cpp_lib_format)
+template <>
+struct std::formatter<Rational> : std::formatter<std::string_view>
+{
+    auto format(const Rational& value, std::format_context& context) const
+    {
+        char buffer[MAX_RATIONAL_CHARS];
+        auto result = FormatRational(buffer, buffer + sizeof(buffer), value);
+        return std::formatter<std::string_view>::format(
+            std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)), context);
+    }
+};
+#endif
@@ -0,0 +1,269 @@
+#include "RationalReduce.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+__extension__ using Int128 = __int128;
+__extension__ using UInt128 = unsigned __int128;
+
+// Values per block. The denominator table of a block has twice as many
+// slots, which keeps probes short and the table within the L1 cache.
+constexpr std::size_t REDUCE_BLOCK = 1024;
+constexpr std::size_t REDUCE_SLOTS = 2 * REDUCE_BLOCK;
+
+// A sum in lowest terms with a positive denominator.
+struct WideFraction
+{
+    Int128 num = 0;
+    std::uint64_t den = 1;
+};
+
+// A term of a sum with a positive denominator, not necessarily in lowest
+// terms.
+struct Term
+{
+    std::int64_t num;
+    std::uint64_t den;
+};
+
+[[noreturn]] void ThrowOverflow()
+{
+    throw std::overflow_error("Rational: sum does not fit");
+}
+
+std::uint64_t BinaryGcd64(std::uint64_t x, std::uint64_t y)
+{
+    if (x == 0 || y == 0)
+    {
+        return x | y;
+    }
+    auto shift = std::countr_zero(x | y);
+    x >>= std::countr_zero(x);
+    do
+    {
+        y >>= std::countr_zero(y);
+        auto low = std::min(x, y);
+        y = std::max(x, y) - low;
+        x = low;
+    } while (y != 0);
+    return x << shift;
+}
+
+// |num| mod den, the value gcd(num, den) depends on.
+std::uint64_t Remainder(Int128 num, std::uint64_t den)
+{
+    auto magnitude = num < 0 ? UInt128(0) - static_cast<UInt128>(num) : static_cast<UInt128>(num);
+    return static_cast<std::uint64_t>(magnitude % den);
+}
+
+// Rational::operator+= on wide fractions, with every product checked.
+WideFraction Add(const WideFraction& lhs, const WideFraction& rhs)
+{
+    auto d1 = BinaryGcd64(lhs.den, rhs.den);
+    Int128 left;
+    Int128 right;
+    Int128 t;
+    if (__builtin_mul_overflow(lhs.num, static_cast<Int128>(rhs.den / d1), &left) ||
+        __builtin_mul_overflow(rhs.num, static_cast<Int128>(lhs.den / d1), &right) ||
+        __builtin_add_overflow(left, right, &t))
+    {
+        ThrowOverflow();
+    }
+    if (t == 0)
+    {
+        return {};
+    }
+    auto d2 = BinaryGcd64(Remainder(t, d1), d1);
+    std::uint64_t den;
+    if (__builtin_mul_overflow(lhs.den / d1, rhs.den / d2, &den))
+    {
+        ThrowOverflow();
+    }
+    return {t / static_cast<Int128>(d2), den};
+}
+
+// Adds neighbours level by level, in place; the sum of fractions[0, count).
+WideFraction PairwiseSum(std::vector<WideFraction>& fractions, std::size_t count)
+{
+    if (count == 0)
+    {
+        return {};
+    }
+    for (; count > 1; count = (count + 1) / 2)
+    {
+        for (std::size_t i = 0; i < count / 2; ++i)
+        {
+            fractions[i] = Add(fractions[2 * i], fractions[2 * i + 1]);
+        }
+        if (count % 2 == 1)
+        {
+            fractions[count / 2] = fractions[count - 1];
+        }
+    }
+    return fractions[0];
+}
+
+// Sums one block at a time. Terms are added into an open-addressing table
+// keyed by denominator, so the numerators of equal denominators are summed
+// as plain integers; the distinct denominators then go through
+// PairwiseSum in the order they first appeared.
+class BlockSummer
+{
+public:
+    BlockSummer() : dens_(REDUCE_SLOTS, 0), sums_(REDUCE_SLOTS), fractions_(REDUCE_BLOCK)
+    {
+        used_.reserve(REDUCE_BLOCK);
+    }
+
+    template <typename Terms>
+    WideFraction Sum(const Terms& terms, std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            Term term = terms(i);
+            auto slot = Slot(term.den);
+            while (dens_[slot] != term.den && dens_[slot] != 0)
+            {
+                slot = (slot + 1) % REDUCE_SLOTS;
+            }
+            if (dens_[slot] == 0)
+            {
+                dens_[slot] = term.den;
+                sums_[slot] = 0;
+                used_.push_back(slot);
+            }
+            sums_[slot] += term.num;
+        }
+
+        std::size_t count = 0;
+        for (auto slot : used_)
+        {
+            auto den = std::exchange(dens_[slot], 0);
+            auto common = BinaryGcd64(Remainder(sums_[slot], den), den);
+            fractions_[count++] = {sums_[slot] / static_cast<Int128>(common), den / common};
+        }
+        used_.clear();
+        return PairwiseSum(fractions_, count);
+    }
+
+private:
+    static std::size_t Slot(std::uint64_t den)
+    {
+        constexpr auto BITS = std::countr_zero(REDUCE_SLOTS);
+        return static_cast<std::size_t>((den * 0x9e3779b97f4a7c15) >> (64 - BITS));
+    }
+
+    std::vector<std::uint64_t> dens_;
+    std::vector<Int128> sums_;
+    std::vector<std::size_t> used_;
+    std::vector<WideFraction> fractions_;
+};
+
+// The shared driver of ReduceSum and Dot: terms(i) gives the i-th term.
+template <typename Terms>
+Rational Reduce(std::size_t size, const Terms& terms, std::size_t threadCount)
+{
+    auto blocks = (size + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(blocks, 1));
+    std::vector<WideFraction> partials(blocks);
+    auto sumBlocks = [&](std::size_t first, std::size_t last)
+    {
+        BlockSummer summer;
+        for (auto block = first; block < last; ++block)
+        {
+            partials[block] = summer.Sum(terms, block * REDUCE_BLOCK, std::min(size, (block + 1) * REDUCE_BLOCK));
+        }
+    };
+
+    std::vector<std::future<void>> pending;
+    auto slice = (blocks + threadCount - 1) / threadCount;
+    for (auto first = slice; first < blocks; first += slice)
+    {
+        pending.push_back(std::async(std::launch::async, sumBlocks, first, std::min(blocks, first + slice)));
+    }
+    sumBlocks(0, std::min(blocks, slice));
+    for (auto& part : pending)
+    {
+        part.get();
+    }
+
+    auto sum = PairwiseSum(partials, blocks);
+    if (sum.num < std::numeric_limits<int>::min() || sum.num > std::numeric_limits<int>::max() ||
+        sum.den > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+    {
+        ThrowOverflow();
+    }
+    return Rational(static_cast<int>(sum.num), static_cast<int>(sum.den));
+}
+
+// a / b * c / d in 64 bits, where it cannot overflow. It is left unreduced:
+// the block sums reduce once per distinct denominator instead of twice per
+// product as Rational::operator*= does.
+Term Product(int a, int b, int c, int d)
+{
+    return {static_cast<std::int64_t>(a) * c, static_cast<std::uint64_t>(b) * static_cast<std::uint64_t>(d)};
+}
+
+void RequireSameSize(std::size_t lhs, std::size_t rhs)
+{
+    if (lhs != rhs)
+    {
+        throw std::invalid_argument("Dot: operand sizes differ");
+    }
+}
+
+} // namespace
+
+Rational ReduceSum(std::span<const Rational> values, std::size_t threadCount)
+{
+    return Reduce(
+        values.size(),
+        [values](std::size_t i)
+        {
+            return Term{values[i].Numerator(), static_cast<std::uint64_t>(values[i].Denominator())};
+        },
+        threadCount);
+}
+
+Rational ReduceSum(const RationalVector& values, std::size_t threadCount)
+{
+    auto numerators = values.Numerators();
+    auto denominators = values.Denominators();
+    return Reduce(
+        values.Size(),
+        [numerators, denominators](std::size_t i)
+        { return Term{numerators[i], static_cast<std::uint64_t>(denominators[i])}; },
+        threadCount);
+}
+
+Rational Dot(std::span<const Rational> lhs, std::span<const Rational> rhs, std::size_t threadCount)
+{
+    RequireSameSize(lhs.size(), rhs.size());
+    return Reduce(
+        lhs.size(),
+        [lhs, rhs](std::size_t i)
+        { return Product(lhs[i].Numerator(), lhs[i].Denominator(), rhs[i].Numerator(), rhs[i].Denominator()); },
+        threadCount);
+}
+
+Rational Dot(const RationalVector& lhs, const RationalVector& rhs, std::size_t threadCount)
+{
+    RequireSameSize(lhs.Size(), rhs.Size());
+    auto lhsNum = lhs.Numerators();
+    auto lhsDen = lhs.Denominators();
+    auto rhsNum = rhs.Numerators();
+    auto rhsDen = rhs.Denominators();
+    return Reduce(
+        lhs.Size(),
+        [=](std::size_t i) { return Product(lhsNum[i], lhsDen[i], rhsNum[i], rhsDen[i]); },
+        threadCount);
+}
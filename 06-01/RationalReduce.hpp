@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Rational.hpp"
+#include "RationalVector.hpp"
+
+#include <cstddef>
+#include <span>
+
+// Exact sum of values. Each block of values first adds the numerators of
+// those that share a denominator, then combines the distinct denominators
+// with a pairwise tree, and the block sums are combined the same way. Every
+// intermediate is the sum of a short contiguous run, held with a 128-bit
+// numerator and a 64-bit denominator, so it stays far smaller than the
+// prefix sums of a left fold, whose denominators grow to the LCM of
+// everything seen so far. With more than one thread the blocks are split
+// among them; the tree depends only on the number of values, so every
+// intermediate and the result are the same for any thread count. Throws
+// std::overflow_error when an intermediate or the sum does not fit.
+Rational ReduceSum(std::span<const Rational> values, std::size_t threadCount = 1);
+Rational ReduceSum(const RationalVector& values, std::size_t threadCount = 1);
+
+// The sum of lhs[i] * rhs[i] like ReduceSum, with each product taken exactly
+// in 64 bits. Throws std::invalid_argument when the sizes differ.
+Rational Dot(std::span<const Rational> lhs, std::span<const Rational> rhs, std::size_t threadCount = 1);
+Rational Dot(const RationalVector& lhs, const RationalVector& rhs, std::size_t threadCount = 1);
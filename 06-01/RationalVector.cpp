@@ -0,0 +1,667 @@
+#include "RationalVector.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+// Columns a kernel reads and writes; the ones it does not use stay null. The
+// outputs may alias the left-hand inputs.
+struct Operands
+{
+    const int* lhsNum = nullptr;
+    const int* lhsDen = nullptr;
+    const int* rhsNum = nullptr;
+    const int* rhsDen = nullptr;
+    int* num = nullptr;
+    int* den = nullptr;
+    std::uint8_t* mask = nullptr;
+    double* values = nullptr;
+    const double* inputs = nullptr;
+    int limit = 0;
+    std::size_t size = 0;
+};
+
+template <std::size_t LANES>
+struct Lanes
+{
+    typedef std::int32_t Int __attribute__((vector_size(4 * LANES)));
+    typedef std::uint32_t Unsigned __attribute__((vector_size(4 * LANES)));
+    typedef float Float __attribute__((vector_size(4 * LANES)));
+    typedef std::int64_t Long __attribute__((vector_size(8 * LANES)));
+    typedef std::uint64_t ULong __attribute__((vector_size(8 * LANES)));
+    typedef double Double __attribute__((vector_size(8 * LANES)));
+    typedef std::uint8_t Byte __attribute__((vector_size(LANES)));
+};
+
+// Reads the register of elements starting at index; lanes past the end of the
+// column are set to fill.
+template <typename V, typename T>
+[[gnu::always_inline]] inline V Load(const T* column, std::size_t index, std::size_t size, T fill)
+{
+    constexpr auto LANES = sizeof(V) / sizeof(T);
+    V lanes = V{} + fill;
+    if (size - index >= LANES)
+    {
+        std::memcpy(&lanes, column + index, sizeof(V));
+    }
+    else
+    {
+        std::memcpy(&lanes, column + index, (size - index) * sizeof(T));
+    }
+    return lanes;
+}
+
+template <typename V, typename T>
+[[gnu::always_inline]] inline void Store(T* column, std::size_t index, std::size_t size, const V& lanes)
+{
+    constexpr auto LANES = sizeof(V) / sizeof(T);
+    if (size - index >= LANES)
+    {
+        std::memcpy(column + index, &lanes, sizeof(V));
+    }
+    else
+    {
+        std::memcpy(column + index, &lanes, (size - index) * sizeof(T));
+    }
+}
+
+template <typename M>
+[[gnu::always_inline]] inline bool Any(const M& mask)
+{
+    std::uint64_t words[sizeof(M) / sizeof(std::uint64_t)];
+    std::memcpy(words, &mask, sizeof(M));
+    std::uint64_t any = 0;
+    for (auto word : words)
+    {
+        any |= word;
+    }
+    return any != 0;
+}
+
+// The lowest set bit converted to float is an exact power of two, so its
+// exponent field is the bit index; there is no vector ctz instruction before
+// AVX-512. Bit 31 turns negative as a signed lane, which only touches the
+// sign bit. Lanes that are zero give garbage.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Unsigned CountTrailingZeros(
+    typename Lanes<LANES>::Unsigned x)
+{
+    using L = Lanes<LANES>;
+    auto lowest = std::bit_cast<typename L::Int>(x & -x);
+    auto bits = std::bit_cast<typename L::Unsigned>(__builtin_convertvector(lowest, typename L::Float));
+    return ((bits >> 23) & 0xFF) - 127;
+}
+
+// Binary GCD in every lane at once, as in Rational.cpp. The loop runs until
+// the slowest lane is done; finished lanes are held by the masks.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Unsigned Gcd(typename Lanes<LANES>::Unsigned x,
+                                                                  typename Lanes<LANES>::Unsigned y)
+{
+    using Unsigned = typename Lanes<LANES>::Unsigned;
+    const Unsigned zero{};
+    auto either = x | y;
+    auto shift = either == 0 ? zero : CountTrailingZeros<LANES>(either);
+    auto xZero = x == 0;
+    x = xZero ? y : x;
+    y = xZero ? zero : y;
+    x >>= x == 0 ? zero : CountTrailingZeros<LANES>(x);
+    while (Any(y != 0))
+    {
+        auto active = y != 0;
+        y >>= active ? CountTrailingZeros<LANES>(y) : zero;
+        auto low = x < y ? x : y;
+        auto high = x < y ? y : x;
+        x = active ? low : x;
+        y = active ? high - low : zero;
+    }
+    return x << shift;
+}
+
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Unsigned Magnitude(typename Lanes<LANES>::Int x)
+{
+    auto bits = std::bit_cast<typename Lanes<LANES>::Unsigned>(x);
+    return x < 0 ? -bits : bits;
+}
+
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Int SignedGcd(typename Lanes<LANES>::Int x,
+                                                                   typename Lanes<LANES>::Int y)
+{
+    return std::bit_cast<typename Lanes<LANES>::Int>(Gcd<LANES>(Magnitude<LANES>(x), Magnitude<LANES>(y)));
+}
+
+// Division by a divisor known to divide the dividend. Both fit in a double
+// exactly and the quotient is an integer, so the rounded division is exact;
+// x86 has no vector integer division at all.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Int ExactDivide(typename Lanes<LANES>::Int dividend,
+                                                                     typename Lanes<LANES>::Int divisor)
+{
+    using L = Lanes<LANES>;
+    divisor = divisor == 0 ? divisor + 1 : divisor;
+    auto quotient = __builtin_convertvector(dividend, typename L::Double) /
+                    __builtin_convertvector(divisor, typename L::Double);
+    return __builtin_convertvector(quotient, typename L::Int);
+}
+
+// Knuth's addition from Rational::operator+= lane by lane.
+template <bool SUBTRACT>
+struct AddKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using Int = typename Lanes<LANES>::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto lhsNum = Load<Int>(operands.lhsNum, i, operands.size, 0);
+            auto lhsDen = Load<Int>(operands.lhsDen, i, operands.size, 1);
+            auto rhsNum = Load<Int>(operands.rhsNum, i, operands.size, 0);
+            auto rhsDen = Load<Int>(operands.rhsDen, i, operands.size, 1);
+            if constexpr (SUBTRACT)
+            {
+                rhsNum = -rhsNum;
+            }
+            auto common = SignedGcd<LANES>(lhsDen, rhsDen);
+            auto lhsScale = ExactDivide<LANES>(rhsDen, common);
+            auto rhsScale = ExactDivide<LANES>(lhsDen, common);
+            auto sum = lhsNum * lhsScale + rhsNum * rhsScale;
+            auto remaining = SignedGcd<LANES>(sum, common);
+            auto den = rhsScale * ExactDivide<LANES>(rhsDen, remaining);
+            Store(operands.num, i, operands.size, ExactDivide<LANES>(sum, remaining));
+            Store(operands.den, i, operands.size, sum == 0 ? Int{} + 1 : den);
+        }
+    }
+};
+
+// Cross-cancelling multiplication from Rational::operator*=; division
+// multiplies by the reciprocal.
+template <bool DIVIDE>
+struct MultiplyKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using Int = typename Lanes<LANES>::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto lhsNum = Load<Int>(operands.lhsNum, i, operands.size, 0);
+            auto lhsDen = Load<Int>(operands.lhsDen, i, operands.size, 1);
+            auto rhsNum = Load<Int>(operands.rhsNum, i, operands.size, 0);
+            auto rhsDen = Load<Int>(operands.rhsDen, i, operands.size, 1);
+            if constexpr (DIVIDE)
+            {
+                auto negative = rhsNum < 0;
+                auto num = negative ? -rhsDen : rhsDen;
+                rhsDen = negative ? -rhsNum : rhsNum;
+                rhsNum = num;
+            }
+            auto left = SignedGcd<LANES>(lhsNum, rhsDen);
+            auto right = SignedGcd<LANES>(rhsNum, lhsDen);
+            Store(operands.num, i, operands.size,
+                  ExactDivide<LANES>(lhsNum, left) * ExactDivide<LANES>(rhsNum, right));
+            Store(operands.den, i, operands.size,
+                  ExactDivide<LANES>(lhsDen, right) * ExactDivide<LANES>(rhsDen, left));
+        }
+    }
+};
+
+// Rational::Reduce lane by lane.
+struct NormalizeKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using Int = typename Lanes<LANES>::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto num = Load<Int>(operands.lhsNum, i, operands.size, 0);
+            auto den = Load<Int>(operands.lhsDen, i, operands.size, 1);
+            auto negative = den < 0;
+            num = negative ? -num : num;
+            den = negative ? -den : den;
+            auto common = SignedGcd<LANES>(num, den);
+            Store(operands.num, i, operands.size, ExactDivide<LANES>(num, common));
+            Store(operands.den, i, operands.size, ExactDivide<LANES>(den, common));
+        }
+    }
+};
+
+// Cross products in 64-bit lanes, as no product of two ints overflows there.
+struct LessKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using L = Lanes<LANES>;
+        using Int = typename L::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto lhsNum = __builtin_convertvector(Load<Int>(operands.lhsNum, i, operands.size, 0), typename L::Long);
+            auto lhsDen = __builtin_convertvector(Load<Int>(operands.lhsDen, i, operands.size, 1), typename L::Long);
+            auto rhsNum = __builtin_convertvector(Load<Int>(operands.rhsNum, i, operands.size, 0), typename L::Long);
+            auto rhsDen = __builtin_convertvector(Load<Int>(operands.rhsDen, i, operands.size, 1), typename L::Long);
+            auto less = lhsNum * rhsDen < rhsNum * lhsDen;
+            Store(operands.mask, i, operands.size, __builtin_convertvector(less & 1, typename L::Byte));
+        }
+    }
+};
+
+// Both sides are in lowest terms, so equal values have equal columns.
+struct EqualKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using L = Lanes<LANES>;
+        using Int = typename L::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto equal = (Load<Int>(operands.lhsNum, i, operands.size, 0) ==
+                          Load<Int>(operands.rhsNum, i, operands.size, 0)) &
+                         (Load<Int>(operands.lhsDen, i, operands.size, 1) ==
+                          Load<Int>(operands.rhsDen, i, operands.size, 1));
+            Store(operands.mask, i, operands.size, __builtin_convertvector(equal & 1, typename L::Byte));
+        }
+    }
+};
+
+struct ToDoubleKernel
+{
+    template <std::size_t LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        using L = Lanes<LANES>;
+        using Int = typename L::Int;
+        for (std::size_t i = 0; i < operands.size; i += LANES)
+        {
+            auto num = Load<Int>(operands.lhsNum, i, operands.size, 0);
+            auto den = Load<Int>(operands.lhsDen, i, operands.size, 1);
+            Store(operands.values, i, operands.size,
+                  __builtin_convertvector(num, typename L::Double) /
+                      __builtin_convertvector(den, typename L::Double));
+        }
+    }
+};
+
+// Rounds lanes in [0, 2^51) to the nearest integer: a sum with 2^52 has no
+// bits below the point.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Double RoundToInteger(typename Lanes<LANES>::Double value)
+{
+    return (value + 0x1p52) - 0x1p52;
+}
+
+// The same sum read as bits, whose pattern minus that of 2^52 is the integer.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::ULong ToInteger(typename Lanes<LANES>::Double value)
+{
+    using L = Lanes<LANES>;
+    const typename L::Double magic = typename L::Double{} + 0x1p52;
+    return std::bit_cast<typename L::ULong>(value + magic) - std::bit_cast<typename L::ULong>(magic);
+}
+
+// The halves of each lane planted in the mantissas of 2^84 and 2^52, which
+// takes a few integer operations and one rounding instead of the scalar
+// conversions x86 needs for 64-bit lanes before AVX-512.
+template <std::size_t LANES>
+[[gnu::always_inline]] inline typename Lanes<LANES>::Double ToDouble(typename Lanes<LANES>::ULong value)
+{
+    using L = Lanes<LANES>;
+    auto high = std::bit_cast<typename L::Double>((value >> 32) | std::bit_cast<std::uint64_t>(0x1p84));
+    auto low = std::bit_cast<typename L::Double>((value & 0xFFFFFFFF) | std::bit_cast<std::uint64_t>(0x1p52));
+    return (high - (0x1p84 + 0x1p52)) + low;
+}
+
+// Rational::FromDouble for one register of 64-bit lanes, as Euclid's
+// algorithm on the exact value p / q = mantissa / 2^scale. Each partial
+// quotient comes from a double division, and the remainder then reveals and
+// fixes one that is one off. Convergents stay below 2^53 before they leave the
+// bounds, so they are kept in doubles, exactly. Lanes outside [2^-10, 2^31),
+// and near ties between the two final candidates, which the doubles cannot
+// settle, are flagged for the scalar path.
+template <std::size_t LANES>
+struct Approximation
+{
+    using L = Lanes<LANES>;
+    using Double = typename L::Double;
+    using Long = typename L::Long;
+    using ULong = typename L::ULong;
+
+    explicit Approximation(Double x)
+    {
+        const ULong implicitBit = ULong{} + (std::uint64_t(1) << 52);
+        auto y = x < 0 ? -x : x;
+        auto inRange = (y >= 0x1p-10) & (y < 0x1p31);
+        auto bits = std::bit_cast<ULong>(y);
+        auto scale = std::bit_cast<ULong>(inRange ? 1075 - std::bit_cast<Long>(bits >> 52) : Long{});
+        p = inRange ? (bits & (implicitBit - 1)) | implicitBit : ULong{};
+        q = (ULong{} + 1) << scale;
+        done = ~inRange;
+        fallback = ~inRange;
+    }
+
+    [[gnu::always_inline]] bool Active() const
+    {
+        return Any(~done);
+    }
+
+    // Once a lane is done, h1 / k1 is its result.
+    [[gnu::always_inline]] void Step(Double maxDen)
+    {
+        const Double maxNum = Double{} + std::numeric_limits<int>::max();
+        auto active = ~done;
+        auto pValue = ToDouble<LANES>(p);
+        auto qValue = ToDouble<LANES>(q);
+        auto estimate = pValue / qValue;
+        auto a = RoundToInteger<LANES>(estimate < 0x1p40 ? estimate : Double{} + 0x1p40);
+        auto r = p - ToInteger<LANES>(a) * q;
+        auto under = std::bit_cast<Long>(r) < 0;
+        a = under ? a - 1 : a;
+        r = under ? r + q : r;
+        auto over = std::bit_cast<Long>(r) >= std::bit_cast<Long>(q);
+        a = over ? a + 1 : a;
+        r = over ? r - q : r;
+
+        // Beyond 2^53 the sums round, but stay beyond the bounds.
+        auto nextH = a * h1 + h0;
+        auto nextK = a * k1 + k0;
+        auto exceeds = (nextH > maxNum) | (nextK > maxDen);
+
+        auto stopping = active & exceeds;
+        if (Any(stopping))
+        {
+            auto numLimit = h1 == 0 ? Double{} + 0x1p40 : (maxNum - h0) / h1;
+            auto denLimit = (maxDen - k0) / (k1 == 0 ? k1 + 1 : k1);
+            auto m = RoundToInteger<LANES>(numLimit < denLimit ? numLimit : denLimit);
+            auto outside = (m * h1 + h0 > maxNum) | (m * k1 + k0 > maxDen);
+            m = outside ? m - 1 : m;
+            auto inside = ((m + 1) * h1 + h0 <= maxNum) & ((m + 1) * k1 + k0 <= maxDen);
+            m = inside ? m + 1 : m;
+            auto lhs = pValue * k1;
+            auto rhs = (2 * m * k1 + k0) * qValue;
+            auto gap = lhs - rhs;
+            auto semi = (m >= 1) & (lhs < rhs);
+            auto tie = (m >= 1) & ((gap < 0 ? -gap : gap) <= 0x1p-40 * rhs);
+            h1 = stopping & semi ? m * h1 + h0 : h1;
+            k1 = stopping & semi ? m * k1 + k0 : k1;
+            fallback |= stopping & tie;
+            done |= stopping;
+        }
+
+        auto continuing = active & ~exceeds;
+        h0 = continuing ? h1 : h0;
+        h1 = continuing ? nextH : h1;
+        k0 = continuing ? k1 : k0;
+        k1 = continuing ? nextK : k1;
+        done |= continuing & (r == 0);
+        p = continuing ? q : p;
+        q = continuing ? r : q;
+    }
+
+    void Store(const Operands& operands, std::size_t index) const
+    {
+        auto x = Load<Double>(operands.inputs, index, operands.size, 0.0);
+        ::Store(operands.num, index, operands.size, __builtin_convertvector(x < 0 ? -h1 : h1, typename L::Int));
+        ::Store(operands.den, index, operands.size, __builtin_convertvector(k1, typename L::Int));
+        ::Store(operands.mask, index, operands.size, __builtin_convertvector(fallback & 1, typename L::Byte));
+    }
+
+    ULong p;
+    ULong q;
+    Double h0{};
+    Double h1 = Double{} + 1;
+    Double k0 = Double{} + 1;
+    Double k1{};
+    Long done;
+    Long fallback;
+};
+
+// A register holds half as many 64-bit lanes as 32-bit ones, and GCC lowers
+// wider vectors of them to scalar code. Two registers are approximated at
+// once, so that the long dependency chain of one step overlaps with the
+// other's.
+struct FromDoubleKernel
+{
+    template <std::size_t REGISTER_LANES>
+    [[gnu::always_inline]] static inline void Run(const Operands& operands)
+    {
+        constexpr auto LANES = REGISTER_LANES / 2;
+        using Double = typename Lanes<LANES>::Double;
+        auto maxDen = Double{} + operands.limit;
+        for (std::size_t i = 0; i < operands.size; i += 2 * LANES)
+        {
+            auto second = i + LANES;
+            Approximation<LANES> first(Load<Double>(operands.inputs, i, operands.size, 0.0));
+            Approximation<LANES> next(second < operands.size ? Load<Double>(operands.inputs, second, operands.size, 0.0)
+                                                             : Double{});
+            while (first.Active() || next.Active())
+            {
+                first.Step(maxDen);
+                next.Step(maxDen);
+            }
+            first.Store(operands, i);
+            if (second < operands.size)
+            {
+                next.Store(operands, second);
+            }
+        }
+    }
+};
+
+using Kernel = void (*)(const Operands&);
+
+// Every kernel is written once with vector extensions and compiled here for
+// four lanes on any target and for eight lanes with AVX2, picked at run time.
+template <typename K>
+void RunPortable(const Operands& operands)
+{
+    K::template Run<4>(operands);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template <typename K>
+__attribute__((target("avx2"))) void RunAvx2(const Operands& operands)
+{
+    K::template Run<8>(operands);
+}
+#endif
+
+template <typename K>
+void Run(const Operands& operands)
+{
+    static const Kernel kernel = []() -> Kernel
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return RunAvx2<K>;
+        }
+#endif
+        return RunPortable<K>;
+    }();
+    kernel(operands);
+}
+
+void RequireSameSize(std::size_t lhs, std::size_t rhs)
+{
+    if (lhs != rhs)
+    {
+        throw std::invalid_argument("RationalVector: operand sizes differ");
+    }
+}
+
+} // namespace
+
+RationalVector::RationalVector(std::size_t size) : numerators_(size, 0), denominators_(size, 1)
+{
+}
+
+RationalVector::RationalVector(std::span<const Rational> values)
+{
+    numerators_.reserve(values.size());
+    denominators_.reserve(values.size());
+    for (const auto& value : values)
+    {
+        PushBack(value);
+    }
+}
+
+RationalVector::RationalVector(std::span<const int> numerators, std::span<const int> denominators)
+    : numerators_(numerators.begin(), numerators.end()),
+      denominators_(denominators.begin(), denominators.end())
+{
+    RequireSameSize(numerators.size(), denominators.size());
+    Operands operands;
+    operands.lhsNum = numerators_.data();
+    operands.lhsDen = denominators_.data();
+    operands.num = numerators_.data();
+    operands.den = denominators_.data();
+    operands.size = Size();
+    Run<NormalizeKernel>(operands);
+}
+
+void RationalVector::Set(std::size_t index, const Rational& value)
+{
+    numerators_[index] = value.Numerator();
+    denominators_[index] = value.Denominator();
+}
+
+void RationalVector::PushBack(const Rational& value)
+{
+    numerators_.push_back(value.Numerator());
+    denominators_.push_back(value.Denominator());
+}
+
+std::vector<Rational> RationalVector::ToRationals() const
+{
+    std::vector<Rational> values;
+    values.reserve(Size());
+    for (std::size_t i = 0; i < Size(); ++i)
+    {
+        values.push_back((*this)[i]);
+    }
+    return values;
+}
+
+namespace
+{
+
+template <typename K>
+void RunInPlace(std::vector<int, AlignedAllocator<int>>& numerators,
+                std::vector<int, AlignedAllocator<int>>& denominators,
+                std::span<const int> otherNumerators, std::span<const int> otherDenominators)
+{
+    RequireSameSize(numerators.size(), otherNumerators.size());
+    Operands operands;
+    operands.lhsNum = numerators.data();
+    operands.lhsDen = denominators.data();
+    operands.rhsNum = otherNumerators.data();
+    operands.rhsDen = otherDenominators.data();
+    operands.num = numerators.data();
+    operands.den = denominators.data();
+    operands.size = numerators.size();
+    Run<K>(operands);
+}
+
+} // namespace
+
+RationalVector& RationalVector::operator+=(const RationalVector& other)
+{
+    RunInPlace<AddKernel<false>>(numerators_, denominators_, other.Numerators(), other.Denominators());
+    return *this;
+}
+
+RationalVector& RationalVector::operator-=(const RationalVector& other)
+{
+    RunInPlace<AddKernel<true>>(numerators_, denominators_, other.Numerators(), other.Denominators());
+    return *this;
+}
+
+RationalVector& RationalVector::operator*=(const RationalVector& other)
+{
+    RunInPlace<MultiplyKernel<false>>(numerators_, denominators_, other.Numerators(), other.Denominators());
+    return *this;
+}
+
+RationalVector& RationalVector::operator/=(const RationalVector& other)
+{
+    RunInPlace<MultiplyKernel<true>>(numerators_, denominators_, other.Numerators(), other.Denominators());
+    return *this;
+}
+
+std::vector<std::uint8_t> RationalVector::Less(const RationalVector& other) const
+{
+    RequireSameSize(Size(), other.Size());
+    std::vector<std::uint8_t> mask(Size());
+    Operands operands;
+    operands.lhsNum = numerators_.data();
+    operands.lhsDen = denominators_.data();
+    operands.rhsNum = other.numerators_.data();
+    operands.rhsDen = other.denominators_.data();
+    operands.mask = mask.data();
+    operands.size = Size();
+    Run<LessKernel>(operands);
+    return mask;
+}
+
+std::vector<std::uint8_t> RationalVector::Equal(const RationalVector& other) const
+{
+    RequireSameSize(Size(), other.Size());
+    std::vector<std::uint8_t> mask(Size());
+    Operands operands;
+    operands.lhsNum = numerators_.data();
+    operands.lhsDen = denominators_.data();
+    operands.rhsNum = other.numerators_.data();
+    operands.rhsDen = other.denominators_.data();
+    operands.mask = mask.data();
+    operands.size = Size();
+    Run<EqualKernel>(operands);
+    return mask;
+}
+
+std::vector<double> RationalVector::ToDoubles() const
+{
+    std::vector<double> values(Size());
+    Operands operands;
+    operands.lhsNum = numerators_.data();
+    operands.lhsDen = denominators_.data();
+    operands.values = values.data();
+    operands.size = Size();
+    Run<ToDoubleKernel>(operands);
+    return values;
+}
+
+RationalVector RationalVector::FromDoubles(std::span<const double> values, int maxDen)
+{
+    if (maxDen < 1)
+    {
+        throw std::invalid_argument("RationalVector: denominator bound below one");
+    }
+    RationalVector result(values.size());
+    std::vector<std::uint8_t> fallback(values.size());
+    Operands operands;
+    operands.inputs = values.data();
+    operands.limit = maxDen;
+    operands.num = result.numerators_.data();
+    operands.den = result.denominators_.data();
+    operands.mask = fallback.data();
+    operands.size = values.size();
+    Run<FromDoubleKernel>(operands);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        if (fallback[i] != 0)
+        {
+            result.Set(i, Rational::FromDouble(values[i], maxDen));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Rational.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <span>
+#include <vector>
+
+inline constexpr std::size_t RATIONAL_VECTOR_ALIGNMENT = 64;
+
+// Hands out storage aligned to a cache line, so the batch kernels never split
+// a load across two lines.
+template <typename T>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(
+            ::operator new(count * sizeof(T), std::align_val_t{RATIONAL_VECTOR_ALIGNMENT}));
+    }
+
+    void deallocate(T* pointer, std::size_t)
+    {
+        ::operator delete(pointer, std::align_val_t{RATIONAL_VECTOR_ALIGNMENT});
+    }
+
+    friend bool operator==(const AlignedAllocator&, const AlignedAllocator&)
+    {
+        return true;
+    }
+};
+
+// Rationals stored as two columns, numerators and denominators, each in lowest
+// terms with a positive denominator like Rational. Element-wise operations run
+// on whole SIMD registers of elements, including the binary GCDs that keep the
+// results reduced, and give the same values as the scalar operators.
+class RationalVector :
+    public Addable<RationalVector>,
+    public Subtractable<RationalVector>,
+    public Multipliable<RationalVector>,
+    public Dividable<RationalVector>
+{
+public:
+    RationalVector() = default;
+    explicit RationalVector(std::size_t size);
+    explicit RationalVector(std::span<const Rational> values);
+
+    // Pairs in any form, reduced here in batches.
+    RationalVector(std::span<const int> numerators, std::span<const int> denominators);
+
+    std::size_t Size() const
+    {
+        return numerators_.size();
+    }
+
+    Rational operator[](std::size_t index) const
+    {
+        return Rational(numerators_[index], denominators_[index], Rational::Reduced{});
+    }
+
+    void Set(std::size_t index, const Rational& value);
+    void PushBack(const Rational& value);
+    std::vector<Rational> ToRationals() const;
+
+    std::span<const int> Numerators() const
+    {
+        return numerators_;
+    }
+
+    std::span<const int> Denominators() const
+    {
+        return denominators_;
+    }
+
+    // Both operands must have the same size; std::invalid_argument otherwise.
+    RationalVector& operator+=(const RationalVector& other);
+    RationalVector& operator-=(const RationalVector& other);
+    RationalVector& operator*=(const RationalVector& other);
+    RationalVector& operator/=(const RationalVector& other);
+
+    // One byte per element, 1 where the comparison holds and 0 elsewhere.
+    std::vector<std::uint8_t> Less(const RationalVector& other) const;
+    std::vector<std::uint8_t> Equal(const RationalVector& other) const;
+
+    std::vector<double> ToDoubles() const;
+
+    // Rational::FromDouble of every value, most of them lane-parallel.
+    static RationalVector FromDoubles(std::span<const double> values,
+                                      int maxDen = std::numeric_limits<int>::max());
+
+private:
+    using Column = std::vector<int, AlignedAllocator<int>>;
+
+    Column numerators_;
+    Column denominators_;
+};
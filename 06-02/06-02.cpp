@@ -5,6 +5,12 @@ import rational;
 
 const double EPSILON_VAL = 1e-6;
 
+// The imported operators are constexpr, so these are folded by the compiler.
+static_assert(Math::Rational(1, 3) + Math::Rational(1, 3) == Math::Rational(2, 3));
+static_assert(Math::Rational(6, -8) == Math::Rational(-3, 4));
+static_assert(Math::Rational(1, 2) * Math::Rational(2, 3) < Math::Rational(1, 2));
+static_assert(static_cast<double>(Math::Rational(1, 4)) == 0.25);
+
 bool AreDoublesEqual(double x, double y)
 {
     return std::abs(x - y) < EPSILON_VAL;
@@ -2,6 +2,7 @@ module;
 
 #include <compare>
 #include <iostream>
+#include <numeric>
 
 export module rational;
 export import :mixins;
@@ -9,6 +10,8 @@ export import :mixins;
 export namespace Math
 {
 
+// Everything but the stream operators is constexpr and defined in this
+// interface, so importers can inline the calls and fold Rational constants.
 class Rational :
     public Addable<Rational>,
     public Subtractable<Rational>,
@@ -18,32 +21,106 @@ class Rational :
     public Decrementable<Rational>
 {
 public:
-    Rational(int num = 0, int den = 1);
+    constexpr Rational(int num = 0, int den = 1);
 
-    explicit operator double() const;
+    constexpr explicit operator double() const;
 
-    Rational& operator+=(const Rational& other);
-    Rational& operator-=(const Rational& other);
-    Rational& operator*=(const Rational& other);
-    Rational& operator/=(const Rational& other);
+    constexpr Rational& operator+=(const Rational& other);
+    constexpr Rational& operator-=(const Rational& other);
+    constexpr Rational& operator*=(const Rational& other);
+    constexpr Rational& operator/=(const Rational& other);
 
-    Rational& operator++();
-    Rational& operator--();
+    constexpr Rational& operator++();
+    constexpr Rational& operator--();
 
     using Incrementable<Rational>::operator++;
     using Decrementable<Rational>::operator--;
 
-    friend std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs);
-    friend bool operator==(const Rational& lhs, const Rational& rhs);
+    friend constexpr std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs);
+    friend constexpr bool operator==(const Rational& lhs, const Rational& rhs);
 
     friend std::istream& operator>>(std::istream& stream, Rational& rational);
     friend std::ostream& operator<<(std::ostream& stream, const Rational& rational);
 
 private:
-    void Reduce();
+    constexpr void Reduce();
 
     int num_;
     int den_;
 };
 
+}
+
+namespace Math
+{
+
+constexpr Rational::Rational(int num, int den) : num_(num), den_(den)
+{
+    Reduce();
+}
+
+constexpr Rational::operator double() const
+{
+    return static_cast<double>(num_) / static_cast<double>(den_);
+}
+
+constexpr Rational& Rational::operator+=(const Rational& other)
+{
+    auto lcm = std::lcm(den_, other.den_);
+    num_ = num_ * (lcm / den_) + other.num_ * (lcm / other.den_);
+    den_ = lcm;
+    Reduce();
+    return *this;
+}
+
+constexpr Rational& Rational::operator-=(const Rational& other)
+{
+    return *this += Rational(-other.num_, other.den_);
+}
+
+constexpr Rational& Rational::operator*=(const Rational& other)
+{
+    num_ *= other.num_;
+    den_ *= other.den_;
+    Reduce();
+    return *this;
+}
+
+constexpr Rational& Rational::operator/=(const Rational& other)
+{
+    return *this *= Rational(other.den_, other.num_);
+}
+
+constexpr Rational& Rational::operator++()
+{
+    return *this += 1;
+}
+
+constexpr Rational& Rational::operator--()
+{
+    return *this -= 1;
+}
+
+constexpr std::strong_ordering operator<=>(const Rational& lhs, const Rational& rhs)
+{
+    return (lhs.num_ * rhs.den_) <=> (rhs.num_ * lhs.den_);
+}
+
+constexpr bool operator==(const Rational& lhs, const Rational& rhs)
+{
+    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+}
+
+constexpr void Rational::Reduce()
+{
+    if (den_ < 0)
+    {
+        num_ = -num_;
+        den_ = -den_;
+    }
+    auto common = std::gcd(num_, den_);
+    num_ /= common;
+    den_ /= common;
+}
+
 }
\ No newline at end of file
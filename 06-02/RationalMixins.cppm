@@ -6,7 +6,7 @@ export namespace Math
 template <typename T>
 struct Addable
 {
-    friend T operator+(T lhs, const T& rhs)
+    friend constexpr T operator+(T lhs, const T& rhs)
     {
         return lhs += rhs;
     }
@@ -15,7 +15,7 @@ struct Addable
 template <typename T>
 struct Subtractable
 {
-    friend T operator-(T lhs, const T& rhs)
+    friend constexpr T operator-(T lhs, const T& rhs)
     {
         return lhs -= rhs;
     }
@@ -24,7 +24,7 @@ struct Subtractable
 template <typename T>
 struct Multipliable
 {
-    friend T operator*(T lhs, const T& rhs)
+    friend constexpr T operator*(T lhs, const T& rhs)
     {
         return lhs *= rhs;
     }
@@ -33,7 +33,7 @@ struct Multipliable
 template <typename T>
 struct Dividable
 {
-    friend T operator/(T lhs, const T& rhs)
+    friend constexpr T operator/(T lhs, const T& rhs)
     {
         return lhs /= rhs;
     }
@@ -42,7 +42,7 @@ struct Dividable
 template <typename T>
 struct Incrementable
 {
-    T operator++(int)
+    constexpr T operator++(int)
     {
         auto& self = static_cast<T&>(*this);
         T temp(self);
@@ -54,7 +54,7 @@ struct Incrementable
 template <typename T>
 struct Decrementable
 {
-    T operator--(int)
+    constexpr T operator--(int)
     {
         auto& self = static_cast<T&>(*this);
         T temp(self);